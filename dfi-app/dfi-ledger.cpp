@@ -4,6 +4,7 @@
 
 #include "dledger/record.hpp"
 #include "dledger/ledger.hpp"
+#include "dledger/typed-record.hpp"
 #include "dynamic-function-runner.h"
 #include <iostream>
 #include <unordered_set>
@@ -17,6 +18,9 @@ std::mt19937 random_gen(rd()); //Standard mersenne_twister_engine seeded with rd
 
 using namespace dledger;
 
+// the three inputs of the filter, read from the record without string conversion
+using DfiInput = RecordSchema<254, IntegerField<1, int32_t>, IntegerField<2, int32_t>, IntegerField<3, int32_t>>;
+
 std::list<std::string> startingPeerPath({
                                                 "./test-certs/test-a.cert",
                                                 "./test-certs/test-b.cert",
@@ -27,10 +31,8 @@ std::list<std::string> startingPeerPath({
 void periodicAddRecord(shared_ptr<Ledger> ledger, Scheduler& scheduler) {
     std::uniform_int_distribution<> distrib(1, 1000000);
     Record record(RecordType::GENERIC_RECORD, std::to_string(distrib(random_gen)));
-    record.addRecordItem(makeStringBlock(255, std::to_string(distrib(random_gen))));
-    record.addRecordItem(makeStringBlock(255, std::to_string(distrib(random_gen))));
-    record.addRecordItem(makeStringBlock(255, std::to_string(distrib(random_gen))));
-    ReturnCode result = ledger->createRecord(record);
+    DfiInput::appendTo(record, std::make_tuple(distrib(random_gen), distrib(random_gen), distrib(random_gen)));
+    ReturnCode result = ledger->createRecord(std::move(record));
     if (!result.success()) {
         std::cout << "- Adding record error : " << result.what() << std::endl;
     }
@@ -41,13 +43,13 @@ void periodicAddRecord(shared_ptr<Ledger> ledger, Scheduler& scheduler) {
 
 Block processRecord(shared_ptr<Ledger> ledger, Name recordName, ndn::Block& executionBlock, const DynamicFunctionRunner& runner) {
     printf("Processing: %s\n", recordName.toUri().c_str());
-    Record r = *ledger->getRecord(recordName.toUri());
-    int inputs[3];
-    int i = 0;
-    for (const auto& item : r.getRecordItems()) {
-        inputs[i] = (int) std::stoi(readString(item));
-        i ++;
+    auto r = ledger->getSharedRecord(recordName.toUri());
+    const Block* item = r == nullptr ? nullptr : DfiInput::find(*r);
+    if (item == nullptr) {
+        std::cout << "- No filter input in record " << recordName.toUri() << std::endl;
+        return makeStringBlock(255, "");
     }
+    int32_t inputs[3] = {DfiInput::get<0>(*item), DfiInput::get<1>(*item), DfiInput::get<2>(*item)};
 
     //process!
     std::vector<uint8_t> buf(12);
@@ -58,10 +60,18 @@ Block processRecord(shared_ptr<Ledger> ledger, Name recordName, ndn::Block& exec
 }
 
 void periodicProcessRecord(shared_ptr<Ledger> ledger, Scheduler& scheduler,
-        std::unordered_set<Name>& waitingRecords,
+        std::unordered_set<Name>& waitingRecords, const ndn::Block& moduleReference,
         ndn::Block& executionBlock, const DynamicFunctionRunner& runner) {
     std::unordered_map<Name, Block> filteredRecords;
 
+    //load the module once its blob is fetched
+    if (!executionBlock.isValid() && moduleReference.isValid()) {
+        auto module = ledger->getBlob(BlobReference(moduleReference));
+        if (module != nullptr) {
+            executionBlock = makeBinaryBlock(253, module->data(), module->size());
+        }
+    }
+
     //pick records to process
     std::set<int> toProcessNum;
     if (waitingRecords.size() <= 5) {
@@ -85,25 +95,23 @@ void periodicProcessRecord(shared_ptr<Ledger> ledger, Scheduler& scheduler,
         }
     }
 
-    //build output block
+    //submit the outputs, coalesced into the records of this peer at the production rate limit
     std::uniform_int_distribution<> distrib(0, 1000000);
-    Record record(RecordType::GENERIC_RECORD, "output_" + std::to_string(distrib(random_gen)));
     for (const auto& filteredItem : filteredRecords) {
         Block block(131);
         block.push_back(filteredItem.first.wireEncode());
         block.push_back(filteredItem.second);
-    }
-    if (executionBlock.isValid() && toProcessNum.size() != 0) {
-        ReturnCode result = ledger->createRecord(record);
-        if (!result.success()) {
-            std::cout << "- Adding record error : " << result.what() << std::endl;
-            scheduler.schedule(time::seconds(1), [&]() { ledger->createRecord(record); });
-        }
+        block.encode();
+        ledger->submitRecordItem(block, [](ReturnCode result) {
+            if (!result.success()) {
+                std::cout << "- Adding output error : " << result.what() << std::endl;
+            }
+        });
     }
 
     // schedule for the next record generation
-    scheduler.schedule(time::milliseconds(15000 + distrib(random_gen) % 10000), [ledger, &scheduler, &waitingRecords, &executionBlock, &runner]
-            { periodicProcessRecord(ledger, scheduler, waitingRecords, executionBlock, runner); });
+    scheduler.schedule(time::milliseconds(15000 + distrib(random_gen) % 10000), [ledger, &scheduler, &waitingRecords, &moduleReference, &executionBlock, &runner]
+            { periodicProcessRecord(ledger, scheduler, waitingRecords, moduleReference, executionBlock, runner); });
 }
 
 void addWasmRecord(shared_ptr<Ledger> ledger) {
@@ -115,8 +123,10 @@ void addWasmRecord(shared_ptr<Ledger> ledger) {
     std::vector<char> buffer(size);
     file.read(buffer.data(), size);
     BOOST_ASSERT(file.good());
-    record.addRecordItem(makeBinaryBlock(253, buffer.data(), buffer.size()));
-    ReturnCode result = ledger->createRecord(record);
+    // the module is large, the record only references it in the blob store
+    auto module = ledger->putBlob(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    record.addRecordItem(module.wireEncode());
+    ReturnCode result = ledger->createRecord(std::move(record));
     if (!result.success()) {
         std::cout << "- Adding record error : " << result.what() << std::endl;
     }
@@ -126,13 +136,14 @@ shared_ptr<Ledger> setupLedger(const std::string& idName, std::shared_ptr<Config
         security::KeyChain &keychain, Face& face, boost::asio::io_service& ioService) {
     shared_ptr<Ledger> ledger = std::move(Ledger::initLedger(*config, keychain, face));
     std::unordered_set<Name> waitingRecords;
+    ndn::Block moduleReference;
     ndn::Block executionBlock;
     DynamicFunctionRunner runner;
 
     ledger->setOnRecordAppConfirmed([&](const Record &record){
         if (record.getUniqueIdentifier() == "dfi_filter1") { // code block
-            executionBlock = *record.getRecordItems().begin();
-        } else if (record.getUniqueIdentifier().substr(0, 6) == "output") { // output block
+            moduleReference = *record.getRecordItems().begin();
+        } else if (!record.getRecordItems().empty() && record.getRecordItems().begin()->type() == 131) { // output block
             for (const auto& item : record.getRecordItems()) {
                 item.parse();
                 auto doneItem = Name(*item.elements_begin());
@@ -148,7 +159,7 @@ shared_ptr<Ledger> setupLedger(const std::string& idName, std::shared_ptr<Config
     }
 
     Scheduler scheduler(ioService);
-    periodicProcessRecord(ledger, scheduler, waitingRecords, executionBlock, runner);
+    periodicProcessRecord(ledger, scheduler, waitingRecords, moduleReference, executionBlock, runner);
     scheduler.schedule(time::seconds(2), [ledger, &scheduler]{periodicAddRecord(ledger, scheduler);});
 
     face.processEvents();
@@ -0,0 +1,106 @@
+#ifndef DLEDGER_INCLUDE_BLOB_H_
+#define DLEDGER_INCLUDE_BLOB_H_
+
+#include <ndn-cxx/encoding/block.hpp>
+#include <ndn-cxx/encoding/buffer.hpp>
+#include <ndn-cxx/name.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * A reference to a blob, i.e., a payload kept once by each peer in its blob store, keyed by SHA-256 digest.
+ * A record carries the reference as an item instead of the payload, so a payload published many times
+ * is stored and transferred once. Blobs are fetched after the records referencing them are accepted,
+ * and checked against the digest.
+ * Blob Segment Name: /<peer-prefix>/BLOB/<digest>/<segment>
+ */
+class BlobReference
+{
+public:
+  BlobReference(ConstBufferPtr digest, size_t size);
+
+  /**
+   * May throw exception if the format is incorrect
+   */
+  explicit
+  BlobReference(const Block& wire);
+
+  /**
+   * Make the reference of a payload.
+   */
+  static BlobReference
+  fromContent(const uint8_t* content, size_t size);
+
+  const Buffer&
+  getDigest() const
+  {
+    return *m_digest;
+  }
+
+  size_t
+  getSize() const
+  {
+    return m_size;
+  }
+
+  size_t
+  getSegmentCount() const
+  {
+    return (m_size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+  }
+
+  /**
+   * Check whether the content has the size and the digest of the reference.
+   */
+  bool
+  matches(const Buffer& content) const;
+
+  Block
+  wireEncode() const;
+
+  void
+  wireDecode(const Block& wire);
+
+  static bool
+  isBlobReference(const Block& item)
+  {
+    return item.type() == T_BlobReference;
+  }
+
+public:
+  /**
+   * The name of the blob served by a peer, without the segment component.
+   */
+  Name
+  makeBlobName(const Name& peerPrefix) const;
+
+  static bool
+  isBlobName(const Name& name);
+
+  /**
+   * @return false if the name is not a well formed blob segment name
+   */
+  static bool
+  parseBlobName(const Name& name, ConstBufferPtr& digest, size_t& segment);
+
+public:
+  /**
+   * The TLV types of the reference.
+   */
+  const static uint32_t T_BlobReference = 140;
+  const static uint32_t T_BlobDigest = 141;
+  const static uint32_t T_BlobSize = 142;
+  /**
+   * The size of the content of a blob segment.
+   */
+  const static size_t SEGMENT_SIZE = 8000;
+
+private:
+  ConstBufferPtr m_digest;
+  size_t m_size;
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_INCLUDE_BLOB_H_
@@ -8,6 +8,8 @@
 #include <ndn-cxx/name.hpp>
 #include <ndn-cxx/security/certificate.hpp>
 #include <ndn-cxx/interest.hpp>
+#include <memory>
+#include <vector>
 #include "record.hpp"
 
 using namespace ndn;
@@ -24,6 +26,22 @@ namespace dledger {
          */
         virtual bool verifySignature(const Data &data) const = 0;
 
+        /**
+         * Verify the signatures of several records, the same as verifySignature on each.
+         * Implementations may share the work between the records signed by the same key.
+         * Must be safe to call concurrently with the other const functions.
+         * @param dataList the data to be checked
+         * @return one result per data, in the same order
+         */
+        virtual std::vector<bool> verifySignatures(const std::vector<std::shared_ptr<const Data>> &dataList) const {
+            std::vector<bool> results;
+            results.reserve(dataList.size());
+            for (const auto &data : dataList) {
+                results.push_back(verifySignature(*data));
+            }
+            return results;
+        }
+
         /**
          * Verify if the certificate or revocation record
          * has correct format
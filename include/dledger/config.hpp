@@ -65,6 +65,76 @@ public:
    * The maximum clock skew allowed for other peer.
    */
   time::milliseconds clockSkewTolerance = time::milliseconds(60000);
+
+  /**
+   * The number of ancestor levels requested in one batch when catching up with a peer.
+   * 0 disables batch fetching and records are fetched one by one.
+   */
+  size_t batchFetchDepth = 16;
+
+  /**
+   * The maximum number of records carried by one batch.
+   */
+  size_t batchMaxRecords = 256;
+
+  /**
+   * The maximum number of ancestor levels collected for a batch requested by a peer.
+   */
+  size_t batchServeMaxDepth = 64;
+
+  /**
+   * The maximum number of batches served to the peers at a time, and their total size in bytes.
+   * A batch is signed and kept for a few seconds; the batches requested beyond these limits are refused.
+   */
+  size_t batchServeLimit = 16;
+  size_t batchServeMaxSize = 16 * 1024 * 1024;
+
+  /**
+   * The number of batches requested ahead of the batch being received during catch-up.
+   * The next batch is requested as soon as the deepest records of the current one arrive,
+   * before they are validated. 0 disables the walk-ahead.
+   */
+  size_t prefetchDepth = 4;
+
+  /**
+   * The maximum number of walk-ahead batches in flight.
+   */
+  size_t prefetchBudget = 8;
+
+  /**
+   * The number of threads verifying record signatures.
+   * 0 verifies the records on the Face thread.
+   */
+  size_t verificationThreads = 2;
+
+  /**
+   * The initial congestion window of fetching, i.e., the number of outstanding Interests.
+   */
+  size_t initialFetchWindow = 4;
+
+  /**
+   * The maximum congestion window of fetching.
+   */
+  size_t maxFetchWindow = 64;
+
+  /**
+   * The maximum number of record items waiting in the submission queue, see Ledger::submitRecordItem.
+   */
+  size_t submissionQueueLimit = 10000;
+
+  /**
+   * The maximum size of a blob referenced by a record, see BlobReference.
+   * The blobs of received records above it are neither stored nor fetched.
+   */
+  size_t maxBlobSize = 64 * 1024 * 1024;
+
+  /**
+   * Whether a fetched generic record joins the DAG on its signed header, which lists the digests of its body
+   * segments, while the segments are fetched in the background. The record is delivered to the application
+   * once its body arrives. Certificate and revocation records always wait for their body.
+   */
+  bool headerFirstSync = true;
+
   /**
    * The multicast prefix, under which an Interest can reach to all the peers in the same multicast group.
    */
@@ -0,0 +1,108 @@
+#ifndef DLEDGER_INCLUDE_ITEM_TREE_H_
+#define DLEDGER_INCLUDE_ITEM_TREE_H_
+
+#include <vector>
+#include <ndn-cxx/encoding/block.hpp>
+#include <ndn-cxx/encoding/buffer.hpp>
+#include <ndn-cxx/name.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * The Merkle tree over the payload items of a record, whose root is listed in the record header.
+ * Leaf: SHA-256(0x00 || item TLV); inner node: SHA-256(0x01 || left || right).
+ * The last node of a level without a sibling moves up to the next level as it is.
+ * An item can then be served alone with an ItemProof and checked against the signed header.
+ */
+class ItemTree
+{
+public:
+  /**
+   * Compute the root over the encoded items; the root of no item is the digest of nothing.
+   */
+  static ConstBufferPtr
+  computeRoot(const Block* items, size_t itemCount);
+
+  static ConstBufferPtr
+  computeLeaf(const Block& item);
+
+  static ConstBufferPtr
+  computeNode(const Buffer& left, const Buffer& right);
+};
+
+/**
+ * The inclusion proof of one record item: the siblings on the path from its leaf to the root.
+ * Item Name: /<record full name>/ITEM/<index>
+ * Item Data Content: <item> <ItemProof>
+ */
+class ItemProof
+{
+public:
+  ItemProof() = default;
+
+  /**
+   * Build the proof of the item at @p index.
+   * May throw exception if the index is out of range
+   */
+  ItemProof(const Block* items, size_t itemCount, size_t index);
+
+  /**
+   * May throw exception if the format is incorrect
+   */
+  explicit
+  ItemProof(const Block& wire);
+
+  size_t
+  getIndex() const
+  {
+    return m_index;
+  }
+
+  /**
+   * Check that @p item is at the index of the proof among the items of a tree of @p itemCount items with @p root.
+   */
+  bool
+  verify(const Block& item, size_t itemCount, const Buffer& root) const;
+
+  Block
+  wireEncode() const;
+
+  void
+  wireDecode(const Block& wire);
+
+public:
+  static Name
+  makeItemName(const Name& recordName, size_t index);
+
+  static bool
+  isItemName(const Name& name);
+
+  /**
+   * @return false if the name is not a well formed item name
+   */
+  static bool
+  parseItemName(const Name& name, Name& recordName, size_t& index);
+
+public:
+  /**
+   * The TLV types of the item tree in the record header.
+   */
+  const static uint32_t T_ItemTree = 132;
+  const static uint32_t T_ItemCount = 133;
+  const static uint32_t T_ItemRoot = 134;
+  /**
+   * The TLV types of the proof.
+   */
+  const static uint32_t T_ItemProof = 135;
+  const static uint32_t T_ItemIndex = 136;
+  const static uint32_t T_ProofNode = 137;
+
+private:
+  size_t m_index = 0;
+  std::vector<ConstBufferPtr> m_path; // from the leaf level up
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_INCLUDE_ITEM_TREE_H_
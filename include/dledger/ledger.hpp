@@ -4,6 +4,7 @@
 #include <iostream>
 #include <optional>
 #include <ndn-cxx/name.hpp>
+#include "dledger/blob.hpp"
 #include "dledger/record.hpp"
 #include "dledger/config.hpp"
 #include "dledger/return-code.hpp"
@@ -13,6 +14,7 @@ namespace dledger {
 
 typedef function<bool(const Data&)> OnRecordAppCheck;
 typedef function<void(const Record&)> OnRecordAppConfirmed;
+typedef function<void(ReturnCode)> OnRecordItemSubmitted;
 
 class Ledger {
 public:
@@ -30,11 +32,47 @@ public:
 
   /**
    * Create a new record to the Dledger.
-   * @p record, input, a record instance which contains the record payload
+   * @p record, input, a record instance which contains the record payload;
+   *    it is completed with the pointers and the Data packet once appended, and left as it is on error
    */
   virtual ReturnCode
   createRecord(Record& record) = 0;
 
+  /**
+   * Create a new record to the Dledger, moving the record into the ledger instead of copying it.
+   * @p record, input, a record instance which contains the record payload; it is left empty
+   */
+  virtual ReturnCode
+  createRecord(Record&& record) = 0;
+
+  /**
+   * Submit a record item to be carried by a generic record of this peer.
+   * The items submitted between two production slots of the rate limit are coalesced into the record
+   * of the next slot, as many as fit into the record packet; the others wait for the following slot.
+   * Records which cannot be created for now, e.g., for lack of tailing records, are retried at the next slot.
+   * @p item, input, the record item
+   * @p onSubmitted, input, invoked once with the full name of the record carrying the item,
+   *                 or with the error if the item cannot be carried
+   */
+  virtual void
+  submitRecordItem(const Block& item, const OnRecordItemSubmitted& onSubmitted) = 0;
+
+  /**
+   * Keep a payload in the blob store, once per digest, to be referenced by records instead of carried in them.
+   * The other peers fetch the blob once they accept a record referencing it.
+   * @p content, input, the payload
+   * @return the reference to add into a record as an item, see BlobReference
+   */
+  virtual BlobReference
+  putBlob(const uint8_t* content, size_t size) = 0;
+
+  /**
+   * Get a blob from the blob store.
+   * @return nullptr if the blob is not in the store, e.g., not fetched yet
+   */
+  virtual ConstBufferPtr
+  getBlob(const BlobReference& reference) const = 0;
+
   /**
    * Get an existing record from the Dledger.
    * @p recordName, input, the name of the record, which is an NDN full name (i.e., containing ImplicitSha256DigestComponent component)
@@ -42,6 +80,14 @@ public:
   virtual optional<Record>
   getRecord(const std::string& recordName) const = 0;
 
+  /**
+   * Get an existing record from the Dledger, shared with the ledger instead of copied.
+   * @p recordName, input, the name of the record, which is an NDN full name (i.e., containing ImplicitSha256DigestComponent component)
+   * @return nullptr if the record does not exist
+   */
+  virtual shared_ptr<const Record>
+  getSharedRecord(const std::string& recordName) const = 0;
+
   /**
    * Check whether the record exists in the Dledger.
    * @p recordName, input, the name of the record, which is an NDN full name (i.e., containing ImplicitSha256DigestComponent component)
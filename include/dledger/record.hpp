@@ -4,8 +4,13 @@
 #include <set>
 #include <vector>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <ndn-cxx/data.hpp>
+#include <ndn-cxx/encoding/encoding-buffer.hpp>
 #include <ndn-cxx/security/certificate.hpp>
+#include <boost/container/small_vector.hpp>
+#include "dledger/item-tree.hpp"
 
 using namespace ndn;
 namespace dledger {
@@ -18,6 +23,15 @@ enum RecordType {
   GENESIS_RECORD = 4,
 };
 
+/**
+ * The pointers to preceding records, usually a few, kept inline.
+ */
+using RecordPointers = boost::container::small_vector<Name, 4>;
+/**
+ * The payload items of a record, usually one or two, kept inline.
+ */
+using RecordItems = boost::container::small_vector<Block, 2>;
+
 /**
  * The record.
  * Record Name: /<application-common-prefix>/<producer-name>/<record-type>/<record-identifier>/<timestamp>
@@ -50,7 +64,7 @@ public: // used for preparing a new record before appending it into the DLedger
    *       This cannot be used when a record has not been appended into the ledger
    * @p recordItem, input, the record payload to add.
    */
-  Name
+  const Name&
   getRecordName() const;
 
   /**
@@ -72,7 +86,7 @@ public: // used for preparing a new record before appending it into the DLedger
   /**
    * Get record payload items.
    */
-  const std::list<Block>&
+  const RecordItems&
   getRecordItems() const;
 
   /**
@@ -81,11 +95,50 @@ public: // used for preparing a new record before appending it into the DLedger
   bool
   isEmpty() const;
 
+  /**
+   * Check whether the record body is carried by separate segments
+   * whose digests are listed in the record header.
+   */
+  bool
+  hasSegmentedBody() const;
+
+  /**
+   * List the Merkle root of the record items in the header, so that each item can be served
+   * and checked alone with its inclusion proof, see ItemTree.
+   * @note This function should only be used to generate a record before adding it to the ledger.
+   */
+  void
+  addItemTree();
+
+  /**
+   * Check whether the header lists the Merkle root of the record items.
+   */
+  bool
+  hasItemTree() const;
+
+  /**
+   * Decode the Data carrying one item of this record and check the item against the item tree in the header.
+   * Only the header of the record is used, so the item can be read without the rest of the body.
+   * May throw exception if the Data does not carry an item of this record
+   */
+  Block
+  decodeItemData(const Data& itemData) const;
+
 public: // used for generating a new record before appending it into the DLedger
   /**
+   * Decode a record from its Data packet, which is shared rather than copied.
+   * The header and the body are decoded on first access, as views into the Data's wire.
+   * May throw exception if the format is incorrect, or later on first access if the header items are
    * @note This constructor is supposed to be used by the LedgerImpl class only
    */
-  Record(const std::shared_ptr<Data>& data);
+  Record(const std::shared_ptr<const Data>& data);
+
+  /**
+   * Decode a record whose full name is computed already, e.g., in a batch.
+   * May throw exception if the format is incorrect
+   * @note This constructor is supposed to be used by the LedgerImpl class only
+   */
+  Record(const std::shared_ptr<const Data>& data, const Name& fullName);
 
   /**
    * @note This constructor is supposed to be used by the LedgerImpl class only
@@ -96,7 +149,7 @@ public: // used for generating a new record before appending it into the DLedger
    * Get the pointers from the header.
    * @note This function is supposed to be used by the DLedger class only
    */
-  const std::list<Name>&
+  const RecordPointers&
   getPointersFromHeader() const;
 
   /**
@@ -115,13 +168,77 @@ public: // used for generating a new record before appending it into the DLedger
   checkPointerCount(int numPointers) const;
 
   /**
-   * Encode the record header and body into the block.
+   * Split the encoded record body into unsigned segments named /<dataName>/<segment>.
+   * @return the segments, or an empty list if the body fits into the record packet
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  std::vector<shared_ptr<Data>>
+  makeBodySegments(const Name& dataName) const;
+
+  /**
+   * List the signed body segments in the header; the body is no longer encoded into the record packet.
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  void
+  setBodySegments(const std::vector<shared_ptr<Data>>& segments);
+
+  /**
+   * Get the full names of the body segments listed in the header.
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  std::vector<Name>
+  getBodySegmentNames() const;
+
+  /**
+   * Decode the record body from its segments.
+   * May throw exception if the segments do not match the header
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  void
+  decodeBodySegments(const std::vector<shared_ptr<const Data>>& segments);
+
+  /**
+   * Check that the record items match the item tree in the header, if any.
+   * May throw exception if they do not
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  void
+  checkItemTree() const;
+
+  /**
+   * Make the unsigned Data carrying one record item and its inclusion proof, see ItemProof.
+   * May throw exception if the record has no item tree or its body does not have the item
+   * @note This function is supposed to be used by the DLedger class only
+   */
+  shared_ptr<Data>
+  makeItemData(size_t index) const;
+
+  /**
+   * Encode the record header and body into the Data Content block.
+   * The size is estimated first, so the block is written at once into a buffer of the exact size.
+   */
+  Block
+  wireEncode() const;
+
+  /**
+   * Append the encoded record header and body to the block.
    * @p block, output, the Data Content block to carry the encoded record.
+   * @deprecated Use wireEncode(), which encodes the record without copying it into the block.
    */
   void
   wireEncode(Block& block) const;
 
-  Name
+  /**
+   * Prepend the Data Content block carrying the record header and body.
+   */
+  template<encoding::Tag TAG>
+  size_t
+  wireEncode(EncodingImpl<TAG>& encoder) const;
+
+  /**
+   * The producer prefix and the generation timestamp are parsed from the record name once.
+   */
+  const Name&
   getProducerPrefix() const;
 
   time::system_clock::TimePoint
@@ -133,18 +250,75 @@ public: // used for generating a new record before appending it into the DLedger
    */
   std::shared_ptr<const Data> m_data;
 
+protected:
+  /**
+   * The header fields and the body payloads of a record.
+   */
+  struct Contents
+  {
+    /**
+     * The list of pointers to preceding records.
+     */
+    RecordPointers recordPointers;
+    /**
+     * The data structure to carry the record body payloads.
+     */
+    RecordItems contentItems;
+    /**
+     * The implicit digests of the body segments, empty if the body is in the record packet.
+     */
+    std::vector<name::Component> bodySegmentDigests;
+    /**
+     * The Merkle tree over the items listed in the header: the number of items and the root,
+     * computed when a record built locally is encoded.
+     */
+    bool hasItemTree = false;
+    mutable size_t itemTreeCount = 0;
+    mutable ConstBufferPtr itemTreeRoot;
+  };
+
+  /**
+   * The contents of a decoded record. The header and body blocks share the wire of m_data and are
+   * decoded into the lists once, on first access, so that several threads can read a const record.
+   * The copies of the record share them.
+   */
+  struct DecodedContents : Contents
+  {
+    Block header;
+    Block body;
+    std::once_flag headerDecoded;
+    std::once_flag bodyDecoded;
+  };
+
 private:
-  void
-  headerWireEncode(Block& block) const;
+  /**
+   * The contents with the header fields decoded.
+   */
+  const Contents&
+  getHeaderContents() const;
 
-  void
-  bodyWireEncode(Block& block) const;
+  /**
+   * The contents with the body items decoded.
+   */
+  const Contents&
+  getBodyContents() const;
 
-  void
-  headerWireDecode(const Block& dataContent);
+  template<encoding::Tag TAG>
+  size_t
+  headerWireEncode(EncodingImpl<TAG>& encoder) const;
 
-  void
-  bodyWireDecode(const Block& dataContent);
+  /**
+   * @p withItems, input, false to encode an empty body when it is carried by segments.
+   */
+  template<encoding::Tag TAG>
+  size_t
+  bodyWireEncode(EncodingImpl<TAG>& encoder, bool withItems) const;
+
+  static void
+  headerWireDecode(DecodedContents& contents);
+
+  static void
+  bodyWireDecode(DecodedContents& contents);
 
 private:
   /**
@@ -155,6 +329,20 @@ private:
    * The TLV type of the record body in the NDN Data Content.
    */
   const static uint8_t T_RecordContent = 130;
+  /**
+   * The TLV type of the body segment digests in the record header.
+   */
+  const static uint8_t T_BodyManifest = 131;
+
+public:
+  /**
+   * The maximum size of the encoded body carried in the record packet, and of a body segment.
+   */
+  const static size_t BODY_SEGMENT_SIZE = 8000;
+  /**
+   * The maximum number of body segments listed in the header of a record.
+   */
+  const static size_t MAX_BODY_SEGMENTS = 240;
 
 private:
   /**
@@ -170,13 +358,32 @@ private:
 
 protected:
   /**
-   * The list of pointers to preceding records.
+   * The contents of a record built locally, or of a decoded record once its body is decoded from segments.
+   */
+  Contents m_contents;
+  /**
+   * The contents of a decoded record, nullptr for a record built locally.
    */
-  std::list<Name> m_recordPointers;
+  std::shared_ptr<DecodedContents> m_decoded;
   /**
-   * The data structure to carry the record body payloads.
+   * The fields of the record name, parsed once when the record is decoded or on first access.
    */
-  std::list<Block> m_contentItems;
+  mutable Name m_producerPrefix;
+  // a Data decoded from a batch has no cached full name
+  Name m_fullName;
+  mutable time::system_clock::TimePoint m_generationTimestamp;
+
+  /**
+   * The certificate items of a decoded certificate record, parsed by the first CertificateRecord
+   * made from it and shared by all the copies of the record.
+   */
+  struct ParsedCertificates
+  {
+    std::once_flag parsed;
+    std::vector<security::Certificate> certificates;
+    std::vector<Name> prevCertificates;
+  };
+  std::shared_ptr<ParsedCertificates> m_parsedCertificates;
 
   friend class LedgerImpl;
 };
@@ -202,18 +409,23 @@ public:
   void
   addCertificateItem(const security::Certificate& certificate);
 
-  const std::list<security::Certificate> &
+  const std::vector<security::Certificate> &
   getCertificates() const;
 
   void
   addPrevCertPointer(const Name& recordName);
 
-  const std::list<Name> &
+  const std::vector<Name> &
   getPrevCertificates() const;
 
 private:
-  std::list<security::Certificate> m_cert_list;
-  std::list<Name> m_prev_cert;
+  static void
+  parseItems(const RecordItems& items, std::vector<security::Certificate>& certificates,
+             std::vector<Name>& prevCertificates);
+
+private:
+  std::vector<security::Certificate> m_cert_list;
+  std::vector<Name> m_prev_cert;
 };
 
 class RevocationRecord : public Record {
@@ -231,11 +443,11 @@ public:
     void
     addCertificateNameItem(const Name &certificateName);
 
-    const std::list<Name> &
+    const std::vector<Name> &
     getRevokedCertificates() const;
 
 private:
-    std::list<Name> m_revoked_cert_list;
+    std::vector<Name> m_revoked_cert_list;
 };
 
 class GenesisRecord : public Record {
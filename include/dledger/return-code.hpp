@@ -13,7 +13,9 @@ enum ErrorCode {
     EC_NoTailingRecord = 1,
     EC_NotEnoughTailingRecord = 2,
     EC_SigningError = 3,
-    EC_TimingError = 4
+    EC_TimingError = 4,
+    EC_RecordTooLarge = 5,
+    EC_SubmissionQueueFull = 6
   };
 
 class ReturnCode {
@@ -30,6 +32,8 @@ public:
 
   static ReturnCode signingError(const std::string& reason) { return ReturnCode(EC_SigningError, reason); }
   static ReturnCode timingError(const std::string& reason) { return ReturnCode(EC_TimingError, reason); }
+  static ReturnCode recordTooLarge() { return ReturnCode(EC_RecordTooLarge, "Record Body Too Large"); }
+  static ReturnCode submissionQueueFull() { return ReturnCode(EC_SubmissionQueueFull, "Submission Queue Full"); }
 
 
   bool success() { return m_errorCode == EC_OK; }
@@ -0,0 +1,328 @@
+#ifndef DLEDGER_INCLUDE_TYPED_RECORD_H_
+#define DLEDGER_INCLUDE_TYPED_RECORD_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "dledger/record.hpp"
+
+namespace dledger {
+
+/**
+ * Typed record payloads.
+ * A schema lists fixed-size fields and encodes all of them into one record item:
+ *   <schema-type> <length> (<field-type> <field-length> <field-value>)...
+ * The field offsets are computed at compile time, so a field is read straight from the Data
+ * buffer of a received record without decoding the item into elements or strings.
+ *
+ * Example:
+ *   using Measurement = RecordSchema<200, IntegerField<1, uint64_t>, IntegerField<2, int32_t>>;
+ *   Measurement::appendTo(record, std::make_tuple(sensorId, temperature));
+ *   ...
+ *   const Block* item = Measurement::find(receivedRecord);
+ *   if (item != nullptr) temperature = Measurement::get<1>(*item);
+ */
+
+namespace detail {
+
+constexpr size_t
+varNumberSize(uint64_t number)
+{
+  return number < 253 ? 1 : number <= 0xFFFF ? 3 : number <= 0xFFFFFFFF ? 5 : 9;
+}
+
+template<typename T>
+void
+writeBigEndian(uint8_t* output, T value)
+{
+  using Unsigned = typename std::make_unsigned<T>::type;
+  auto bits = static_cast<Unsigned>(value);
+  for (size_t i = sizeof(T); i-- > 0;) {
+    output[i] = static_cast<uint8_t>(bits & 0xFF);
+    bits = static_cast<Unsigned>(bits >> 4 >> 4);
+  }
+}
+
+template<typename T>
+T
+readBigEndian(const uint8_t* input)
+{
+  using Unsigned = typename std::make_unsigned<T>::type;
+  Unsigned bits = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    bits = static_cast<Unsigned>((bits << 4 << 4) | input[i]);
+  }
+  return static_cast<T>(bits);
+}
+
+template<typename... Fields>
+constexpr size_t
+fieldOffset(size_t index)
+{
+  const size_t sizes[] = {Fields::ENCODED_SIZE..., 0};
+  size_t offset = 0;
+  for (size_t i = 0; i < index; i++) {
+    offset += sizes[i];
+  }
+  return offset;
+}
+
+} // namespace detail
+
+/**
+ * An integer field, encoded in big-endian order with the width of its type.
+ */
+template<uint32_t TYPE, typename T>
+struct IntegerField
+{
+  static_assert(std::is_integral<T>::value, "IntegerField holds an integer type");
+  static_assert(TYPE < 253, "the field type must be encoded in one octet");
+
+  using ValueType = T;
+  static constexpr uint32_t TLV_TYPE = TYPE;
+  static constexpr size_t VALUE_SIZE = sizeof(T);
+  static constexpr size_t ENCODED_SIZE = 2 + VALUE_SIZE;
+
+  static void
+  write(uint8_t* output, ValueType value)
+  {
+    detail::writeBigEndian(output, value);
+  }
+
+  static ValueType
+  read(const uint8_t* input)
+  {
+    return detail::readBigEndian<T>(input);
+  }
+};
+
+/**
+ * A fixed-size byte string field, such as a digest or an identifier.
+ */
+template<uint32_t TYPE, size_t SIZE>
+struct BytesField
+{
+  static_assert(TYPE < 253 && SIZE < 253, "the field type and length must be encoded in one octet");
+
+  using ValueType = std::array<uint8_t, SIZE>;
+  static constexpr uint32_t TLV_TYPE = TYPE;
+  static constexpr size_t VALUE_SIZE = SIZE;
+  static constexpr size_t ENCODED_SIZE = 2 + VALUE_SIZE;
+
+  static void
+  write(uint8_t* output, const ValueType& value)
+  {
+    std::copy(value.begin(), value.end(), output);
+  }
+
+  static ValueType
+  read(const uint8_t* input)
+  {
+    ValueType value;
+    std::copy(input, input + SIZE, value.begin());
+    return value;
+  }
+};
+
+/**
+ * The schema of a record item made of fixed-size fields.
+ * @p TYPE, the TLV type of the record item
+ * @p Fields, the fields of the item, in order
+ */
+template<uint32_t TYPE, typename... Fields>
+class RecordSchema
+{
+public:
+  using Values = std::tuple<typename Fields::ValueType...>;
+
+  template<size_t I>
+  using FieldType = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+  static constexpr size_t FIELD_COUNT = sizeof...(Fields);
+  static constexpr size_t VALUE_SIZE = detail::fieldOffset<Fields...>(FIELD_COUNT);
+  static constexpr size_t ENCODED_SIZE =
+    detail::varNumberSize(TYPE) + detail::varNumberSize(VALUE_SIZE) + VALUE_SIZE;
+
+  /**
+   * Encode the values into a record item, in a buffer of the exact size.
+   */
+  static Block
+  encode(const Values& values)
+  {
+    auto buffer = make_shared<Buffer>(ENCODED_SIZE);
+    uint8_t* output = buffer->data();
+    output += writeVarNumber(output, TYPE);
+    output += writeVarNumber(output, VALUE_SIZE);
+    encodeFields(output, values, std::index_sequence_for<Fields...>());
+    return Block(buffer);
+  }
+
+  /**
+   * Add the values as an item of a new record.
+   */
+  static void
+  appendTo(Record& record, const Values& values)
+  {
+    record.addRecordItem(encode(values));
+  }
+
+  /**
+   * Check whether the record item is encoded with this schema.
+   */
+  static bool
+  matches(const Block& item)
+  {
+    if (item.type() != TYPE || item.value_size() != VALUE_SIZE) {
+      return false;
+    }
+    return checkFieldHeaders(item.value(), std::index_sequence_for<Fields...>());
+  }
+
+  /**
+   * Find the first item of the record encoded with this schema.
+   * @return nullptr if none
+   */
+  static const Block*
+  find(const Record& record)
+  {
+    for (const auto& item : record.getRecordItems()) {
+      if (matches(item)) {
+        return &item;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Read one field from the record item.
+   * May throw exception if the item is not encoded with this schema
+   */
+  template<size_t I>
+  static typename FieldType<I>::ValueType
+  get(const Block& item)
+  {
+    checkItem(item);
+    return readField<I>(item.value());
+  }
+
+  /**
+   * Read all the fields from the record item.
+   * May throw exception if the item is not encoded with this schema
+   */
+  static Values
+  decode(const Block& item)
+  {
+    checkItem(item);
+    return decodeFields(item.value(), std::index_sequence_for<Fields...>());
+  }
+
+private:
+  static size_t
+  writeVarNumber(uint8_t* output, uint64_t number)
+  {
+    if (number < 253) {
+      output[0] = static_cast<uint8_t>(number);
+      return 1;
+    }
+    if (number <= 0xFFFF) {
+      output[0] = 253;
+      detail::writeBigEndian(output + 1, static_cast<uint16_t>(number));
+      return 3;
+    }
+    if (number <= 0xFFFFFFFF) {
+      output[0] = 254;
+      detail::writeBigEndian(output + 1, static_cast<uint32_t>(number));
+      return 5;
+    }
+    output[0] = 255;
+    detail::writeBigEndian(output + 1, number);
+    return 9;
+  }
+
+  static void
+  checkItem(const Block& item)
+  {
+    if (!matches(item)) {
+      BOOST_THROW_EXCEPTION(tlv::Error("The record item does not match the schema"));
+    }
+  }
+
+  template<size_t I>
+  static typename FieldType<I>::ValueType
+  readField(const uint8_t* value)
+  {
+    // past the one-octet type and length of the field
+    return FieldType<I>::read(value + detail::fieldOffset<Fields...>(I) + 2);
+  }
+
+  template<size_t... I>
+  static void
+  encodeFields(uint8_t* value, const Values& values, std::index_sequence<I...>)
+  {
+    using Expand = int[];
+    (void)Expand{0, (encodeField<I>(value, std::get<I>(values)), 0)...};
+  }
+
+  template<size_t I>
+  static void
+  encodeField(uint8_t* value, const typename FieldType<I>::ValueType& fieldValue)
+  {
+    uint8_t* output = value + detail::fieldOffset<Fields...>(I);
+    output[0] = static_cast<uint8_t>(FieldType<I>::TLV_TYPE);
+    output[1] = static_cast<uint8_t>(FieldType<I>::VALUE_SIZE);
+    FieldType<I>::write(output + 2, fieldValue);
+  }
+
+  template<size_t... I>
+  static bool
+  checkFieldHeaders(const uint8_t* value, std::index_sequence<I...>)
+  {
+    bool isValid = true;
+    using Expand = int[];
+    (void)Expand{0, (isValid = isValid && checkFieldHeader<I>(value), 0)...};
+    return isValid;
+  }
+
+  template<size_t I>
+  static bool
+  checkFieldHeader(const uint8_t* value)
+  {
+    const uint8_t* header = value + detail::fieldOffset<Fields...>(I);
+    return header[0] == FieldType<I>::TLV_TYPE && header[1] == FieldType<I>::VALUE_SIZE;
+  }
+
+  template<size_t... I>
+  static Values
+  decodeFields(const uint8_t* value, std::index_sequence<I...>)
+  {
+    return Values(readField<I>(value)...);
+  }
+};
+
+template<uint32_t TYPE, typename T>
+constexpr uint32_t IntegerField<TYPE, T>::TLV_TYPE;
+template<uint32_t TYPE, typename T>
+constexpr size_t IntegerField<TYPE, T>::VALUE_SIZE;
+template<uint32_t TYPE, typename T>
+constexpr size_t IntegerField<TYPE, T>::ENCODED_SIZE;
+
+template<uint32_t TYPE, size_t SIZE>
+constexpr uint32_t BytesField<TYPE, SIZE>::TLV_TYPE;
+template<uint32_t TYPE, size_t SIZE>
+constexpr size_t BytesField<TYPE, SIZE>::VALUE_SIZE;
+template<uint32_t TYPE, size_t SIZE>
+constexpr size_t BytesField<TYPE, SIZE>::ENCODED_SIZE;
+
+template<uint32_t TYPE, typename... Fields>
+constexpr size_t RecordSchema<TYPE, Fields...>::FIELD_COUNT;
+template<uint32_t TYPE, typename... Fields>
+constexpr size_t RecordSchema<TYPE, Fields...>::VALUE_SIZE;
+template<uint32_t TYPE, typename... Fields>
+constexpr size_t RecordSchema<TYPE, Fields...>::ENCODED_SIZE;
+
+} // namespace dledger
+
+#endif // DLEDGER_INCLUDE_TYPED_RECORD_H_
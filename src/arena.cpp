@@ -0,0 +1,59 @@
+#include "arena.hpp"
+
+#include <algorithm>
+
+namespace dledger {
+
+const size_t Arena::MAX_BLOCK_SIZE;
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize)
+{
+}
+
+void*
+Arena::allocate(size_t size, size_t alignment)
+{
+  size_t padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+  if (m_current == nullptr || padding + size > m_remaining) {
+    addBlock(size + alignment);
+    padding = (alignment - reinterpret_cast<uintptr_t>(m_current) % alignment) % alignment;
+  }
+  void* p = m_current + padding;
+  m_current += padding + size;
+  m_remaining -= padding + size;
+  m_used += padding + size;
+  return p;
+}
+
+void
+Arena::reset()
+{
+  if (m_blocks.size() > 1) {
+    // the next packet is likely to need as much, keep one block large enough
+    m_blockSize = std::min(std::max(m_blockSize, m_used), MAX_BLOCK_SIZE);
+    m_blocks.clear();
+  }
+  m_current = nullptr;
+  m_remaining = 0;
+  m_used = 0;
+  if (!m_blocks.empty()) {
+    m_current = m_blocks.front().get();
+    m_remaining = m_blockSize;
+  }
+}
+
+void
+Arena::addBlock(size_t minSize)
+{
+  // the first block has the kept size, the others only serve until the next reset
+  size_t size = std::max(m_blocks.empty() ? m_blockSize : m_blockSize / 2, minSize);
+  if (m_blocks.empty()) {
+    m_blockSize = size;
+  }
+  m_blocks.emplace_back(new uint8_t[size]);
+  m_current = m_blocks.back().get();
+  m_remaining = size;
+}
+
+} // namespace dledger
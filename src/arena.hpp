@@ -0,0 +1,161 @@
+#ifndef DLEDGER_SRC_ARENA_H_
+#define DLEDGER_SRC_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+#include <ndn-cxx/name.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * A monotonic arena for the temporaries of processing one packet.
+ * Memory is handed out from a block and only released all at once when the outermost
+ * ArenaScope ends. The block grows to the peak use, so a steady stream of packets
+ * is processed without going to the heap.
+ * Not thread-safe: an arena belongs to the thread processing the packets.
+ */
+class Arena
+{
+public:
+  explicit
+  Arena(size_t blockSize = 16 * 1024);
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void*
+  allocate(size_t size, size_t alignment);
+
+  /**
+   * Release everything allocated so far.
+   */
+  void
+  reset();
+
+private:
+  void
+  addBlock(size_t minSize);
+
+private:
+  /**
+   * The largest block kept across resets.
+   */
+  const static size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+  size_t m_blockSize;
+  std::vector<std::unique_ptr<uint8_t[]>> m_blocks;
+  uint8_t* m_current = nullptr;
+  size_t m_remaining = 0;
+  size_t m_used = 0; // in all blocks since the last reset
+  size_t m_depth = 0;
+
+  friend class ArenaScope;
+};
+
+/**
+ * The processing of one packet; the arena is reset when the outermost scope ends,
+ * so functions opening their own scope can be nested.
+ */
+class ArenaScope
+{
+public:
+  explicit
+  ArenaScope(Arena& arena)
+    : m_arena(arena)
+  {
+    m_arena.m_depth++;
+  }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+  ~ArenaScope()
+  {
+    if (--m_arena.m_depth == 0) {
+      m_arena.reset();
+    }
+  }
+
+private:
+  Arena& m_arena;
+};
+
+/**
+ * Allocator of the standard containers drawing from an arena; deallocation does nothing.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+  using value_type = T;
+
+  explicit
+  ArenaAllocator(Arena& arena) noexcept
+    : m_arena(&arena)
+  {
+  }
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+    : m_arena(other.m_arena)
+  {
+  }
+
+  T*
+  allocate(size_t n)
+  {
+    return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void
+  deallocate(T*, size_t) noexcept
+  {
+  }
+
+  template<typename U>
+  bool
+  operator==(const ArenaAllocator<U>& other) const noexcept
+  {
+    return m_arena == other.m_arena;
+  }
+
+  template<typename U>
+  bool
+  operator!=(const ArenaAllocator<U>& other) const noexcept
+  {
+    return m_arena != other.m_arena;
+  }
+
+private:
+  Arena* m_arena;
+
+  template<typename U>
+  friend class ArenaAllocator;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<typename T, typename Compare = std::less<T>>
+using ArenaSet = std::set<T, Compare, ArenaAllocator<T>>;
+
+/**
+ * Orders names held elsewhere, so that the containers of the arena keep pointers rather than copies.
+ */
+struct NamePointerLess
+{
+  bool
+  operator()(const Name* lhs, const Name* rhs) const
+  {
+    return *lhs < *rhs;
+  }
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_SRC_ARENA_H_
@@ -2,9 +2,31 @@
 
 #include <cassert>
 #include <iostream>
+#include <leveldb/write_batch.h>
+#include <ndn-cxx/util/string-helper.hpp>
 
 namespace dledger {
 
+// record keys are name URIs, starting with '/'
+static std::string
+makeBlobKey(const Buffer& digest)
+{
+  return "#blob/" + toHex(digest);
+}
+
+static std::string
+makeBlobReferenceKey(const Buffer& digest)
+{
+  return "#blob-references/" + toHex(digest);
+}
+
+// written with the blob, so that its existence is checked without reading the payload
+static std::string
+makeBlobStoredKey(const Buffer& digest)
+{
+  return "#blob-stored/" + toHex(digest);
+}
+
 Backend::Backend(const std::string& dbDir)
 {
     leveldb::Options options;
@@ -38,10 +60,23 @@ Backend::getRecord(const Name& recordName) const
   }
 }
 
+bool
+Backend::hasRecord(const Name& recordName) const
+{
+  std::string value;
+  return m_db->Get(leveldb::ReadOptions(), recordName.toUri(), &value).ok();
+}
+
 bool
 Backend::putRecord(const shared_ptr<const Data>& recordData)
 {
-  const auto& nameStr = recordData->getFullName().toUri();
+  return putRecord(recordData->getFullName(), recordData);
+}
+
+bool
+Backend::putRecord(const Name& fullName, const shared_ptr<const Data>& recordData)
+{
+  const auto& nameStr = fullName.toUri();
   leveldb::Slice key = nameStr;
   auto recordBytes = recordData->wireEncode();
   leveldb::Slice value((const char*)recordBytes.wire(), recordBytes.size());
@@ -77,4 +112,78 @@ Backend::listRecord(const Name& prefix) const
     return std::move(names);
 }
 
+ConstBufferPtr
+Backend::getBlob(const Buffer& digest) const
+{
+  std::string value;
+  leveldb::Status s = m_db->Get(leveldb::ReadOptions(), makeBlobKey(digest), &value);
+  if (!s.ok()) {
+    return nullptr;
+  }
+  return make_shared<Buffer>(value.data(), value.size());
+}
+
+bool
+Backend::hasBlob(const Buffer& digest) const
+{
+  std::string value;
+  return m_db->Get(leveldb::ReadOptions(), makeBlobStoredKey(digest), &value).ok();
+}
+
+bool
+Backend::putBlob(const Buffer& digest, const uint8_t* content, size_t size)
+{
+  leveldb::WriteBatch batch;
+  batch.Put(makeBlobKey(digest), leveldb::Slice((const char*)content, size));
+  batch.Put(makeBlobStoredKey(digest), leveldb::Slice());
+  leveldb::Status s = m_db->Write(leveldb::WriteOptions(), &batch);
+  return s.ok();
+}
+
+size_t
+Backend::getBlobReferenceCount(const Buffer& digest) const
+{
+  std::string value;
+  leveldb::Status s = m_db->Get(leveldb::ReadOptions(), makeBlobReferenceKey(digest), &value);
+  if (!s.ok()) {
+    return 0;
+  }
+  return std::stoul(value);
+}
+
+size_t
+Backend::addBlobReference(const Buffer& digest)
+{
+  size_t count = getBlobReferenceCount(digest) + 1;
+  leveldb::Status s = m_db->Put(leveldb::WriteOptions(), makeBlobReferenceKey(digest), std::to_string(count));
+  if (!s.ok()) {
+    std::cerr << "Unable to add blob reference, key: " << makeBlobReferenceKey(digest) << std::endl;
+    std::cerr << s.ToString() << std::endl;
+  }
+  return count;
+}
+
+size_t
+Backend::removeBlobReference(const Buffer& digest)
+{
+  size_t count = getBlobReferenceCount(digest);
+  leveldb::WriteBatch batch;
+  if (count <= 1) {
+    count = 0;
+    batch.Delete(makeBlobReferenceKey(digest));
+    batch.Delete(makeBlobKey(digest));
+    batch.Delete(makeBlobStoredKey(digest));
+  }
+  else {
+    count--;
+    batch.Put(makeBlobReferenceKey(digest), std::to_string(count));
+  }
+  leveldb::Status s = m_db->Write(leveldb::WriteOptions(), &batch);
+  if (!s.ok()) {
+    std::cerr << "Unable to remove blob reference, key: " << makeBlobReferenceKey(digest) << std::endl;
+    std::cerr << s.ToString() << std::endl;
+  }
+  return count;
+}
+
 }  // namespace dledger
\ No newline at end of file
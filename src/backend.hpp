@@ -19,15 +19,55 @@ public:
   shared_ptr<Data>
   getRecord(const Name& recordName) const;
 
+  // whether the record is stored, without decoding it
+  bool
+  hasRecord(const Name& recordName) const;
+
   bool
   putRecord(const shared_ptr<const Data>& recordData);
 
+  // @param fullName the full name of the record, when it is known already
+  bool
+  putRecord(const Name& fullName, const shared_ptr<const Data>& recordData);
+
   void
   deleteRecord(const Name& recordName);
 
   std::list<Name>
   listRecord(const Name& prefix) const;
 
+public:
+  /**
+   * The blob store: payloads kept once by their SHA-256 digest, with the number of stored records
+   * referencing them. The keys are out of the name space of the records, so listRecord skips them.
+   */
+  // @return nullptr if the blob is not stored
+  ConstBufferPtr
+  getBlob(const Buffer& digest) const;
+
+  bool
+  hasBlob(const Buffer& digest) const;
+
+  // @param digest the digest of the content, checked by the caller
+  bool
+  putBlob(const Buffer& digest, const uint8_t* content, size_t size);
+
+  // @return the number of references after adding this one
+  size_t
+  addBlobReference(const Buffer& digest);
+
+  /**
+   * Remove a reference to a blob, e.g., when a record referencing it is pruned.
+   * The blob is deleted with its last reference.
+   * @return the number of references left
+   */
+  size_t
+  removeBlobReference(const Buffer& digest);
+
+private:
+  size_t
+  getBlobReferenceCount(const Buffer& digest) const;
+
 private:
   leveldb::DB* m_db;
 };
@@ -0,0 +1,91 @@
+#include "dledger/blob.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/util/sha256.hpp>
+
+namespace dledger {
+
+static const std::string BLOB_COMPONENT = "BLOB";
+
+const uint32_t BlobReference::T_BlobReference;
+const uint32_t BlobReference::T_BlobDigest;
+const uint32_t BlobReference::T_BlobSize;
+const size_t BlobReference::SEGMENT_SIZE;
+
+BlobReference::BlobReference(ConstBufferPtr digest, size_t size)
+    : m_digest(std::move(digest))
+    , m_size(size)
+{
+  if (m_digest == nullptr || m_digest->size() != util::Sha256::DIGEST_SIZE) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Bad blob digest"));
+  }
+}
+
+BlobReference::BlobReference(const Block& wire)
+{
+  wireDecode(wire);
+}
+
+BlobReference
+BlobReference::fromContent(const uint8_t* content, size_t size)
+{
+  return BlobReference(util::Sha256::computeDigest(content, size), size);
+}
+
+bool
+BlobReference::matches(const Buffer& content) const
+{
+  return content.size() == m_size && *util::Sha256::computeDigest(content.data(), content.size()) == *m_digest;
+}
+
+Block
+BlobReference::wireEncode() const
+{
+  auto wire = makeEmptyBlock(T_BlobReference);
+  wire.push_back(makeBinaryBlock(T_BlobDigest, m_digest->data(), m_digest->size()));
+  wire.push_back(makeNonNegativeIntegerBlock(T_BlobSize, m_size));
+  wire.encode();
+  return wire;
+}
+
+void
+BlobReference::wireDecode(const Block& wire)
+{
+  if (wire.type() != T_BlobReference) {
+    BOOST_THROW_EXCEPTION(tlv::Error("Bad blob reference type"));
+  }
+  wire.parse();
+  const auto& digest = wire.get(T_BlobDigest);
+  if (digest.value_size() != util::Sha256::DIGEST_SIZE) {
+    BOOST_THROW_EXCEPTION(tlv::Error("Bad blob digest"));
+  }
+  m_digest = make_shared<Buffer>(digest.value(), digest.value_size());
+  m_size = readNonNegativeInteger(wire.get(T_BlobSize));
+}
+
+Name
+BlobReference::makeBlobName(const Name& peerPrefix) const
+{
+  return Name(peerPrefix).append(BLOB_COMPONENT).append(m_digest->data(), m_digest->size());
+}
+
+bool
+BlobReference::isBlobName(const Name& name)
+{
+  return name.size() >= 3 && name.get(-1).isSegment() &&
+         name.get(-2).isGeneric() && name.get(-2).value_size() == util::Sha256::DIGEST_SIZE &&
+         name.get(-3).isGeneric() && readString(name.get(-3)) == BLOB_COMPONENT;
+}
+
+bool
+BlobReference::parseBlobName(const Name& name, ConstBufferPtr& digest, size_t& segment)
+{
+  if (!isBlobName(name)) {
+    return false;
+  }
+  digest = make_shared<Buffer>(name.get(-2).value(), name.get(-2).value_size());
+  segment = name.get(-1).toSegment();
+  return true;
+}
+
+} // namespace dledger
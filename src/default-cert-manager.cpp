@@ -2,12 +2,61 @@
 // Created by Tyler on 8/8/20.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <thread>
 #include <utility>
+#include <ndn-cxx/security/pib/key.hpp>
 #include <ndn-cxx/security/verification-helpers.hpp>
 #include "default-cert-manager.h"
 #include "record_name.hpp"
 
+namespace {
+
+// verify with a parsed key, the same as security::verifySignature with a certificate
+bool verifyWithKey(const Data &data, const security::transform::PublicKey &key) {
+    const Block &wire = data.wireEncode();
+    wire.parse();
+    auto sigValue = wire.find(tlv::SignatureValue);
+    if (sigValue == wire.elements_end()) return false;
+    return security::verifySignature(wire.value(), sigValue->begin() - wire.value(),
+                                     sigValue->value(), sigValue->value_size(), key);
+}
+
+// the SignatureValue is the last name component of a signed Interest
+bool verifyWithKey(const Interest &interest, const security::transform::PublicKey &key) {
+    const Name &name = interest.getName();
+    if (name.size() < 2) return false;
+    const Block &nameBlock = name.wireEncode();
+    Block sigValue = name.get(-1).blockFromValue();
+    return security::verifySignature(nameBlock.value(), nameBlock.value_size() - name.get(-1).size(),
+                                     sigValue.value(), sigValue.value_size(), key);
+}
+
+// fewer items are not worth starting a thread
+const size_t MIN_ITEMS_PER_THREAD = 64;
+
+// run the task on each index below count, on several threads if there are many
+void runInParallel(size_t count, const std::function<void(size_t)> &task) {
+    size_t nThreads = std::min<size_t>(std::thread::hardware_concurrency(), count / MIN_ITEMS_PER_THREAD);
+    std::atomic<size_t> next(0);
+    auto runTasks = [&] {
+        for (size_t i = next++; i < count; i = next++) task(i);
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) {
+        threads.emplace_back(runTasks);
+    }
+    runTasks();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
+
 dledger::DefaultCertificateManager::DefaultCertificateManager(const Name &peerPrefix,
                                                               shared_ptr<security::Certificate> anchorCert,
                                                               const std::list<security::Certificate> &startingPeers)
@@ -16,22 +65,78 @@ dledger::DefaultCertificateManager::DefaultCertificateManager(const Name &peerPr
     if (!m_anchorCert->isValid()) {
         BOOST_THROW_EXCEPTION(std::runtime_error("trust Anchor Expired"));
     }
-    m_peerCertificates[m_anchorCert->getIdentity()].push_back(*m_anchorCert);
+    addCertificate(*m_anchorCert);
+    m_anchorKey = parsePublicKey(*m_anchorCert);
     for (const auto &certificate: startingPeers) {
-        m_peerCertificates[certificate.getIdentity()].push_back(certificate);
+        addCertificate(certificate);
     }
 }
 
+const size_t dledger::DefaultCertificateManager::MAX_MEMO_SIZE;
+
 bool dledger::DefaultCertificateManager::verifySignature(const Data &data) const {
-    auto identity = RecordName(data.getName()).getProducerPrefix();
-    auto iterator = m_peerCertificates.find(identity);
-    if (iterator == m_peerCertificates.cend()) return false;
-    for (const auto &cert : iterator->second) {
-        if (security::verifySignature(data, cert)) {
-            return true;
+    if (!data.getSignature().hasKeyLocator()) return false;
+    const auto &recordName = data.getFullName();
+    {
+        std::lock_guard<std::mutex> lock(m_memoMutex);
+        if (m_verifiedRecords.count(recordName) != 0) return true;
+    }
+    auto identity = data.getName().getPrefix(RecordName::parse(data.getName()).producerPrefixSize);
+    auto entry = findVerifyingCertificate(data, data.getSignature().getKeyLocator().getName(), identity);
+    if (entry == nullptr) return false;
+    rememberVerification(recordName, entry->certificate->getKeyName());
+    return true;
+}
+
+std::vector<bool>
+dledger::DefaultCertificateManager::verifySignatures(const std::vector<std::shared_ptr<const Data>> &dataList) const {
+    std::vector<bool> results(dataList.size(), false);
+    // first: key name, second: indexes of the records to verify with the key
+    std::unordered_map<Name, std::vector<size_t>> keyGroups;
+    {
+        std::lock_guard<std::mutex> lock(m_memoMutex);
+        for (size_t i = 0; i < dataList.size(); i++) {
+            const auto &data = *dataList[i];
+            if (!data.getSignature().hasKeyLocator()) continue;
+            if (m_verifiedRecords.count(data.getFullName()) != 0) {
+                results[i] = true;
+                continue;
+            }
+            keyGroups[getKeyName(data.getSignature().getKeyLocator().getName())].push_back(i);
+        }
+    }
+
+    for (const auto &group : keyGroups) {
+        auto iterator = m_keyCertificates.find(group.first);
+        if (iterator == m_keyCertificates.cend()) continue;
+        auto identity = security::extractIdentityFromKeyName(group.first);
+        // the certificate which verified the last record of the key is tried first
+        const CertificateEntry *lastEntry = nullptr;
+        for (auto i : group.second) {
+            const auto &data = *dataList[i];
+            if (!RecordName::isProducedBy(data.getName(), identity)) continue;
+            auto verifies = [&data](const CertificateEntry &entry) {
+                return entry.publicKey != nullptr ? verifyWithKey(data, *entry.publicKey)
+                                                  : security::verifySignature(data, *entry.certificate);
+            };
+            const CertificateEntry *verifyingEntry = nullptr;
+            if (lastEntry != nullptr && verifies(*lastEntry)) {
+                verifyingEntry = lastEntry;
+            } else {
+                for (const auto &entry : iterator->second) {
+                    if (&entry != lastEntry && verifies(entry)) {
+                        verifyingEntry = &entry;
+                        break;
+                    }
+                }
+            }
+            if (verifyingEntry == nullptr) continue;
+            lastEntry = verifyingEntry;
+            results[i] = true;
+            rememberVerification(data.getFullName(), group.first);
         }
     }
-    return false;
+    return results;
 }
 
 bool dledger::DefaultCertificateManager::verifyRecordFormat(const dledger::Record &record) const {
@@ -43,9 +148,16 @@ bool dledger::DefaultCertificateManager::verifyRecordFormat(const dledger::Recor
         }
         try {
             auto certRecord = CertificateRecord(record);
-            for (const auto &cert: certRecord.getCertificates()) {
-                if (!security::verifySignature(cert, *m_anchorCert)) {
-                    std::cout << "-- invalid certificate: " << cert.getName() << std::endl;
+            const auto &certificates = certRecord.getCertificates();
+            // a record onboarding many peers carries thousands of certificates
+            std::vector<char> isValid(certificates.size());
+            runInParallel(certificates.size(), [&](size_t i) {
+                isValid[i] = m_anchorKey != nullptr ? verifyWithKey(certificates[i], *m_anchorKey)
+                                                    : security::verifySignature(certificates[i], *m_anchorCert);
+            });
+            for (size_t i = 0; i < certificates.size(); i++) {
+                if (!isValid[i]) {
+                    std::cout << "-- invalid certificate: " << certificates[i].getName() << std::endl;
                     return false;
                 }
             }
@@ -81,42 +193,96 @@ bool dledger::DefaultCertificateManager::verifyRecordFormat(const dledger::Recor
 }
 
 bool dledger::DefaultCertificateManager::endorseSignature(const Data &data) const {
-    auto identity = RecordName(data.getName()).getProducerPrefix();
-    auto iterator = m_peerCertificates.find(identity);
-    if (iterator == m_peerCertificates.cend()) return false;
-    for (const auto &cert : iterator->second) {
-        if (m_revokedCertificates.count(cert.getFullName())) continue;
-        if (security::verifySignature(data, cert)) {
-            return true;
-        }
+    if (!data.getSignature().hasKeyLocator()) return false;
+    const auto &recordName = data.getFullName();
+    Name keyName;
+    {
+        std::lock_guard<std::mutex> lock(m_memoMutex);
+        auto iterator = m_verifiedRecords.find(recordName);
+        if (iterator != m_verifiedRecords.end()) keyName = iterator->second;
     }
-    return false;
+    // verified before, only the revocation needs to be checked
+    if (!keyName.empty()) return hasValidCertificate(keyName);
+
+    auto identity = data.getName().getPrefix(RecordName::parse(data.getName()).producerPrefixSize);
+    auto key = findValidKey(data, getKeyName(data.getSignature().getKeyLocator().getName()), identity);
+    if (key == nullptr) return false;
+    rememberVerification(recordName, key->keyName);
+    return true;
 }
 
 bool dledger::DefaultCertificateManager::verifySignature(const Interest &interest) const {
-    SignatureInfo info(interest.getName().get(-2).blockFromValue());
-    auto identity = info.getKeyLocator().getName().getPrefix(-2);
-    auto iterator = m_peerCertificates.find(identity);
-    if (iterator == m_peerCertificates.cend()) return false;
-    for (const auto &cert : iterator->second) {
-        if (m_revokedCertificates.count(cert.getFullName())) continue;
-        if (security::verifySignature(interest, cert)) {
-            return true;
+    // the Interest comes from anyone, its signature components may be missing or malformed
+    try {
+        if (interest.getName().size() < 2) return false;
+        SignatureInfo info(interest.getName().get(-2).blockFromValue());
+        if (!info.hasKeyLocator() || info.getKeyLocator().getType() != tlv::Name) return false;
+        auto keyName = getKeyName(info.getKeyLocator().getName());
+        auto identity = security::extractIdentityFromKeyName(keyName);
+        return findValidKey(interest, keyName, identity) != nullptr;
+    } catch (const std::exception &e) {
+        std::cout << "-- Bad Interest signature format. " << e.what() << std::endl;
+        return false;
+    }
+}
+
+template<typename Packet>
+const dledger::DefaultCertificateManager::CertificateEntry *
+dledger::DefaultCertificateManager::findVerifyingCertificate(const Packet &packet, const Name &keyLocatorName,
+                                                             const Name &identity) const {
+    auto keyName = getKeyName(keyLocatorName);
+    if (security::extractIdentityFromKeyName(keyName) != identity) return nullptr;
+    auto iterator = m_keyCertificates.find(keyName);
+    if (iterator == m_keyCertificates.cend()) return nullptr;
+    // usually one certificate per key, more only if a key is certified again
+    for (const auto &entry : iterator->second) {
+        bool isValid = entry.publicKey != nullptr ? verifyWithKey(packet, *entry.publicKey)
+                                                  : security::verifySignature(packet, *entry.certificate);
+        if (isValid) {
+            return &entry;
         }
     }
-    return false;
+    return nullptr;
+}
+
+template<typename Packet>
+const dledger::DefaultCertificateManager::VerifierKey *
+dledger::DefaultCertificateManager::findValidKey(const Packet &packet, const Name &keyName,
+                                                 const Name &identity) const {
+    // the keys of an identity are all certified for the identity
+    auto iterator = m_validKeys.find(identity);
+    if (iterator == m_validKeys.cend()) return nullptr;
+    for (const auto &key : iterator->second) {
+        if (key.keyName != keyName) continue;
+        bool isValid = key.publicKey != nullptr ? verifyWithKey(packet, *key.publicKey)
+                                                : security::verifySignature(packet, *key.certificate);
+        if (isValid) {
+            return &key;
+        }
+    }
+    return nullptr;
+}
+
+bool dledger::DefaultCertificateManager::hasValidCertificate(const Name &keyName) const {
+    auto iterator = m_validKeys.find(security::extractIdentityFromKeyName(keyName));
+    if (iterator == m_validKeys.cend()) return false;
+    return std::any_of(iterator->second.begin(), iterator->second.end(),
+                       [&keyName](const VerifierKey &key) { return key.keyName == keyName; });
+}
+
+void dledger::DefaultCertificateManager::rememberVerification(const Name &recordName, const Name &keyName) const {
+    std::lock_guard<std::mutex> lock(m_memoMutex);
+    if (m_verifiedRecords.size() >= MAX_MEMO_SIZE) {
+        m_verifiedRecords.clear();
+    }
+    m_verifiedRecords[recordName] = keyName;
 }
 
 void dledger::DefaultCertificateManager::acceptRecord(const dledger::Record &record) {
     if (record.getType() == RecordType::CERTIFICATE_RECORD) {
         try {
             auto certRecord = CertificateRecord(record);
-            for (const auto &cert: certRecord.getCertificates()) {
-                if (m_revokedCertificates.count(cert.getFullName()))
-                    continue;
-                std::cout << "Insert certificate " << cert.getName() << std::endl;
-                m_peerCertificates[cert.getIdentity()].push_back(cert);
-            }
+            addCertificates(certRecord.getCertificates());
         } catch (const std::exception &e) {
             std::cout << "-- Bad certificate record format. " << std::endl;
             return;
@@ -127,6 +293,35 @@ void dledger::DefaultCertificateManager::acceptRecord(const dledger::Record &rec
             for (const auto &certName: revokeRecord.getRevokedCertificates()) {
                 std::cout << "Revoke certificate " << certName << std::endl;
                 m_revokedCertificates.insert(certName);
+                auto keyName = security::extractKeyNameFromCertName(certName.getPrefix(-1));
+                auto iterator = m_keyCertificates.find(keyName);
+                if (iterator == m_keyCertificates.end()) continue;
+                // still kept to verify the records signed before the revocation
+                for (auto &entry : iterator->second) {
+                    if (entry.fullName == certName) {
+                        entry.revoked = true;
+                        entry.publicKey = nullptr;
+                    }
+                }
+                auto identity = security::extractIdentityFromKeyName(keyName);
+                auto validKeys = m_validKeys.find(identity);
+                if (validKeys != m_validKeys.end()) {
+                    auto &keys = validKeys->second;
+                    keys.erase(std::remove_if(keys.begin(), keys.end(),
+                                              [&certName](const VerifierKey &key) {
+                                                  return key.certificateName == certName;
+                                              }),
+                               keys.end());
+                    if (keys.empty()) m_validKeys.erase(validKeys);
+                }
+                // records verified by a key without valid certificate must be checked again
+                if (!hasValidCertificate(keyName)) {
+                    std::lock_guard<std::mutex> lock(m_memoMutex);
+                    for (auto it = m_verifiedRecords.begin(); it != m_verifiedRecords.end();) {
+                        if (it->second == keyName) it = m_verifiedRecords.erase(it);
+                        else it++;
+                    }
+                }
             }
         } catch (const std::exception &e) {
             std::cout << "-- Bad revocation record format. " << std::endl;
@@ -144,7 +339,65 @@ Name dledger::DefaultCertificateManager::getCertificateNameIdentity(const Name &
 }
 
 bool dledger::DefaultCertificateManager::authorizedToGenerate() const {
-    auto iterator = m_peerCertificates.find(m_peerPrefix);
-    if (iterator == m_peerCertificates.cend()) return false;
-    return !iterator->second.empty();
+    return m_validKeys.count(m_peerPrefix) != 0;
+}
+
+Name dledger::DefaultCertificateManager::getKeyName(const Name &keyLocatorName) {
+    if (security::Certificate::isValidName(keyLocatorName))
+        return security::extractKeyNameFromCertName(keyLocatorName);
+    return keyLocatorName;
+}
+
+void dledger::DefaultCertificateManager::addCertificate(const security::Certificate &certificate) {
+    auto fullName = certificate.getFullName();
+    bool revoked = m_revokedCertificates.count(fullName) != 0;
+    addCertificate(certificate, fullName, revoked ? nullptr : parsePublicKey(certificate));
+}
+
+void dledger::DefaultCertificateManager::addCertificates(const std::vector<security::Certificate> &certificates) {
+    std::vector<Name> fullNames(certificates.size());
+    std::vector<shared_ptr<security::transform::PublicKey>> publicKeys(certificates.size());
+    runInParallel(certificates.size(), [&](size_t i) {
+        fullNames[i] = certificates[i].getFullName();
+        publicKeys[i] = parsePublicKey(certificates[i]);
+    });
+
+    m_keyCertificates.reserve(m_keyCertificates.size() + certificates.size());
+    m_validKeys.reserve(m_validKeys.size() + certificates.size());
+    size_t inserted = 0;
+    for (size_t i = 0; i < certificates.size(); i++) {
+        if (m_revokedCertificates.count(fullNames[i])) continue;
+        if (addCertificate(certificates[i], fullNames[i], std::move(publicKeys[i]))) inserted++;
+    }
+    std::cout << "Insert " << inserted << " certificates" << std::endl;
+}
+
+shared_ptr<security::transform::PublicKey>
+dledger::DefaultCertificateManager::parsePublicKey(const security::Certificate &certificate) {
+    try {
+        auto publicKey = make_shared<security::transform::PublicKey>();
+        auto keyBits = certificate.getPublicKey();
+        publicKey->loadPkcs8(keyBits.data(), keyBits.size());
+        return publicKey;
+    } catch (const std::exception &e) {
+        std::cout << "-- Cannot parse the key of certificate " << certificate.getName() << std::endl;
+        return nullptr;
+    }
+}
+
+bool dledger::DefaultCertificateManager::addCertificate(const security::Certificate &certificate,
+                                                        const Name &fullName,
+                                                        shared_ptr<security::transform::PublicKey> publicKey) {
+    auto &entries = m_keyCertificates[certificate.getKeyName()];
+    for (const auto &entry : entries) {
+        if (entry.fullName == fullName) return false;
+    }
+    bool revoked = m_revokedCertificates.count(fullName) != 0;
+    auto sharedCertificate = make_shared<const security::Certificate>(certificate);
+    entries.push_back(CertificateEntry{sharedCertificate, fullName, revoked, publicKey});
+    if (!revoked) {
+        m_validKeys[certificate.getIdentity()].push_back(
+                VerifierKey{certificate.getKeyName(), fullName, sharedCertificate, std::move(publicKey)});
+    }
+    return true;
 }
@@ -5,7 +5,12 @@
 #ifndef DLEDGER_DEFAULT_CERT_MANAGER_H
 #define DLEDGER_DEFAULT_CERT_MANAGER_H
 
+#include <mutex>
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
+#include <ndn-cxx/security/transform/public-key.hpp>
 #include "dledger/cert-manager.hpp"
 
 using namespace ndn;
@@ -19,6 +24,12 @@ namespace dledger {
 
         bool verifySignature(const Data &data) const override;
 
+        /**
+         * Records are grouped by the key named in their KeyLocator, so the certificates
+         * of a key are looked up once per group.
+         */
+        std::vector<bool> verifySignatures(const std::vector<std::shared_ptr<const Data>> &dataList) const override;
+
         bool verifyRecordFormat(const Record &record) const override;
 
         bool endorseSignature(const Data &data) const override;
@@ -30,12 +41,88 @@ namespace dledger {
         bool authorizedToGenerate() const override;
 
     private:
+        struct CertificateEntry {
+            shared_ptr<const security::Certificate> certificate;
+            Name fullName;
+            bool revoked;
+            // the parsed public key, dropped when the certificate is revoked
+            shared_ptr<security::transform::PublicKey> publicKey;
+        };
+
+        // a key with a certificate which is not revoked
+        struct VerifierKey {
+            Name keyName;
+            Name certificateName; // full name
+            shared_ptr<const security::Certificate> certificate;
+            shared_ptr<security::transform::PublicKey> publicKey; // nullptr if the key cannot be parsed
+        };
+
         Name getCertificateNameIdentity(const Name &certificateName) const;
 
+        /**
+         * Get the key name from a KeyLocator name, which is either a key name or a certificate name.
+         */
+        static Name getKeyName(const Name &keyLocatorName);
+
+        void addCertificate(const security::Certificate &certificate);
+
+        /**
+         * Add the certificates of a certificate record at once: their digests and keys are computed
+         * on several threads, then they are inserted without rehashing the index on the way.
+         */
+        void addCertificates(const std::vector<security::Certificate> &certificates);
+
+        /**
+         * @return false if the certificate is known already
+         */
+        bool addCertificate(const security::Certificate &certificate, const Name &fullName,
+                            shared_ptr<security::transform::PublicKey> publicKey);
+
+        /**
+         * Parse the key once instead of on each verification.
+         * @return nullptr if the key cannot be parsed
+         */
+        static shared_ptr<security::transform::PublicKey> parsePublicKey(const security::Certificate &certificate);
+
+        /**
+         * Verify the signature with the certificates of the key named by the KeyLocator,
+         * revoked certificates included.
+         * @param identity the identity the key must belong to
+         * @return the certificate verifying the signature, nullptr if none
+         */
+        template<typename Packet>
+        const CertificateEntry *findVerifyingCertificate(const Packet &packet, const Name &keyLocatorName,
+                                                         const Name &identity) const;
+
+        /**
+         * Verify the signature with the valid keys of the identity.
+         * @return the key verifying the signature, nullptr if none
+         */
+        template<typename Packet>
+        const VerifierKey *findValidKey(const Packet &packet, const Name &keyName, const Name &identity) const;
+
+        bool hasValidCertificate(const Name &keyName) const;
+
+        /**
+         * Remember the key whose certificate verified a record.
+         * @param recordName the full name of the record
+         */
+        void rememberVerification(const Name &recordName, const Name &keyName) const;
+
         Name m_peerPrefix;
         std::shared_ptr<security::Certificate> m_anchorCert;
-        std::map<Name, std::list<security::Certificate>> m_peerCertificates; // first: name of the peer, second: certificate
+        shared_ptr<security::transform::PublicKey> m_anchorKey;
+        std::unordered_map<Name, std::vector<CertificateEntry>> m_keyCertificates; // first: key name, second: certificates of the key
+        // first: identity, second: its keys with a certificate not revoked, updated as certificates
+        // and revocations are accepted, so the endorsement checks never see revoked certificates
+        std::unordered_map<Name, std::vector<VerifierKey>> m_validKeys;
         std::unordered_set<Name> m_revokedCertificates;
+
+        // verified signatures, so a record is verified only once
+        // the signature checks can run on several threads, hence the mutex
+        mutable std::mutex m_memoMutex;
+        mutable std::unordered_map<Name, Name> m_verifiedRecords; // first: full name of record, second: key name
+        const static size_t MAX_MEMO_SIZE = 65536;
     };
 };
 
@@ -0,0 +1,194 @@
+#include "fetch-scheduler.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace dledger {
+
+const int FetchScheduler::MAX_RETRIES;
+
+static const time::milliseconds MIN_RTO(200);
+static const time::milliseconds MAX_RTO(4000);
+
+FetchScheduler::FetchScheduler(Face& face, size_t initialWindow, size_t maxWindow)
+    : m_face(face)
+    , m_window(std::max<size_t>(initialWindow, 1))
+    , m_threshold(maxWindow)
+    , m_maxWindow(std::max<size_t>(maxWindow, 1))
+{
+}
+
+void
+FetchScheduler::fetch(const Interest& interest, FetchPriority priority, size_t rank,
+                      const DataCallback& onData, const FailureCallback& onFailure)
+{
+  const Name& name = interest.getName();
+  if (m_inFlight.count(name) != 0) {
+    return;
+  }
+  auto queued = m_queuedNames.find(name);
+  if (queued != m_queuedNames.end()) {
+    if (std::make_tuple(priority, rank) < std::make_tuple(std::get<0>(queued->second), std::get<1>(queued->second))) {
+      auto it = m_queue.find(queued->second);
+      Request request = std::move(it->second);
+      m_queue.erase(it);
+      m_queuedNames.erase(queued);
+      enqueue(std::move(request), priority, rank);
+    }
+    return;
+  }
+  enqueue(Request{interest, onData, onFailure, 0}, priority, rank);
+  sendQueued();
+}
+
+bool
+FetchScheduler::isPending(const Name& name) const
+{
+  return m_inFlight.count(name) != 0 || m_queuedNames.count(name) != 0;
+}
+
+time::milliseconds
+FetchScheduler::getRto() const
+{
+  if (!m_hasRttSample) {
+    return MAX_RTO;
+  }
+  auto rto = time::duration_cast<time::milliseconds>(m_srtt + 4 * m_rttVar);
+  return std::min(std::max(rto, MIN_RTO), MAX_RTO);
+}
+
+void
+FetchScheduler::enqueue(Request request, FetchPriority priority, size_t rank)
+{
+  QueueKey key(priority, rank, m_sequence++);
+  m_queuedNames[request.interest.getName()] = key;
+  m_queue.emplace(key, std::move(request));
+}
+
+void
+FetchScheduler::sendQueued()
+{
+  while (m_inFlight.size() < static_cast<size_t>(m_window) && !m_queue.empty()) {
+    auto it = m_queue.begin();
+    FetchPriority priority = std::get<0>(it->first);
+    size_t rank = std::get<1>(it->first);
+    Request request = std::move(it->second);
+    m_queue.erase(it);
+    Name name = request.interest.getName();
+    m_queuedNames.erase(name);
+
+    request.interest.setInterestLifetime(getRto());
+    request.interest.refreshNonce();
+    auto handle = m_face.expressInterest(request.interest,
+                                         bind(&FetchScheduler::onData, this, name, _1, _2),
+                                         bind(&FetchScheduler::onNack, this, name, _1, _2),
+                                         bind(&FetchScheduler::onTimeout, this, name, _1));
+    m_inFlight.emplace(name, InFlightRequest{std::move(request), priority, rank,
+                                             time::steady_clock::now(), std::move(handle)});
+  }
+}
+
+void
+FetchScheduler::onData(const Name& name, const Interest& interest, const Data& data)
+{
+  auto it = m_inFlight.find(name);
+  if (it == m_inFlight.end()) {
+    return;
+  }
+  // retransmitted Interests give ambiguous samples
+  if (it->second.request.retries == 0) {
+    addRttSample(time::steady_clock::now() - it->second.sendTime);
+  }
+  DataCallback onData = std::move(it->second.request.onData);
+  m_inFlight.erase(it);
+
+  if (m_window < m_threshold) {
+    m_window += 1;
+  }
+  else {
+    m_window += 1 / m_window;
+  }
+  m_window = std::min(m_window, static_cast<double>(m_maxWindow));
+
+  if (onData) {
+    onData(interest, data);
+  }
+  sendQueued();
+}
+
+void
+FetchScheduler::onNack(const Name& name, const Interest& interest, const lp::Nack& nack)
+{
+  std::cout << "Received Nack with reason " << nack.getReason() << std::endl;
+  auto it = m_inFlight.find(name);
+  if (it == m_inFlight.end()) {
+    return;
+  }
+  FailureCallback onFailure = std::move(it->second.request.onFailure);
+  m_inFlight.erase(it);
+  decreaseWindow();
+
+  if (onFailure) {
+    onFailure(interest);
+  }
+  sendQueued();
+}
+
+void
+FetchScheduler::onTimeout(const Name& name, const Interest& interest)
+{
+  auto it = m_inFlight.find(name);
+  if (it == m_inFlight.end()) {
+    return;
+  }
+  decreaseWindow();
+  // the lifetime follows the RTO, so give a slow producer another chance
+  if (it->second.request.retries < MAX_RETRIES) {
+    Request request = std::move(it->second.request);
+    FetchPriority priority = it->second.priority;
+    size_t rank = it->second.rank;
+    m_inFlight.erase(it);
+    request.retries++;
+    enqueue(std::move(request), priority, rank);
+    sendQueued();
+    return;
+  }
+
+  std::cout << "Timeout for " << interest << std::endl;
+  FailureCallback onFailure = std::move(it->second.request.onFailure);
+  m_inFlight.erase(it);
+  if (onFailure) {
+    onFailure(interest);
+  }
+  sendQueued();
+}
+
+void
+FetchScheduler::addRttSample(time::nanoseconds rtt)
+{
+  // RFC 6298
+  if (!m_hasRttSample) {
+    m_srtt = rtt;
+    m_rttVar = rtt / 2;
+    m_hasRttSample = true;
+    return;
+  }
+  auto delta = m_srtt > rtt ? m_srtt - rtt : rtt - m_srtt;
+  m_rttVar = (3 * m_rttVar + delta) / 4;
+  m_srtt = (7 * m_srtt + rtt) / 8;
+}
+
+void
+FetchScheduler::decreaseWindow()
+{
+  // the losses of one window are one congestion event
+  auto now = time::steady_clock::now();
+  if (m_hasRttSample && now - m_lastDecrease < m_srtt) {
+    return;
+  }
+  m_lastDecrease = now;
+  m_threshold = std::max(m_window / 2, 1.0);
+  m_window = m_threshold;
+}
+
+} // namespace dledger
@@ -0,0 +1,144 @@
+#ifndef DLEDGER_SRC_FETCH_SCHEDULER_H_
+#define DLEDGER_SRC_FETCH_SCHEDULER_H_
+
+#include <functional>
+#include <map>
+#include <tuple>
+#include <ndn-cxx/face.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * The priority classes of fetching. A lower class is always sent first.
+ */
+enum class FetchPriority {
+  /**
+   * Certificate records, SYNC processing waits for them.
+   */
+  CERTIFICATE = 0,
+  /**
+   * Ancestors and bodies of records waiting in the sync stack.
+   */
+  ANCESTOR = 1,
+  /**
+   * Tailing records announced by SYNC Interests.
+   */
+  TIP = 2,
+  BACKGROUND = 3,
+};
+
+/**
+ * Limits the Interests a peer has outstanding for fetching records.
+ * Interests wait in a queue ordered by priority class and rank, and are sent
+ * while the number of outstanding Interests is below the congestion window.
+ * The window grows additively with each Data (slow start below the threshold)
+ * and is halved at most once per RTT on timeout or Nack.
+ * Interest lifetimes follow the RTT estimation (SRTT + 4 * RTTVAR).
+ */
+class FetchScheduler
+{
+public:
+  using FailureCallback = std::function<void(const Interest&)>;
+
+  FetchScheduler(Face& face, size_t initialWindow, size_t maxWindow);
+
+  /**
+   * Queue an Interest.
+   * An Interest whose name is already queued or outstanding is not sent again;
+   * it only raises the priority of the queued one.
+   * @param rank the order inside the priority class, lower first
+   * @param onFailure called on Nack, or on timeout after the retries
+   */
+  void
+  fetch(const Interest& interest, FetchPriority priority, size_t rank,
+        const DataCallback& onData, const FailureCallback& onFailure);
+
+  bool
+  isPending(const Name& name) const;
+
+  size_t
+  getWindow() const
+  {
+    return static_cast<size_t>(m_window);
+  }
+
+  size_t
+  getNumInFlight() const
+  {
+    return m_inFlight.size();
+  }
+
+  size_t
+  getNumQueued() const
+  {
+    return m_queue.size();
+  }
+
+  time::milliseconds
+  getRto() const;
+
+private:
+  struct Request
+  {
+    Interest interest;
+    DataCallback onData;
+    FailureCallback onFailure;
+    int retries;
+  };
+
+  struct InFlightRequest
+  {
+    Request request;
+    FetchPriority priority;
+    size_t rank;
+    time::steady_clock::TimePoint sendTime;
+    ScopedPendingInterestHandle handle;
+  };
+
+  using QueueKey = std::tuple<FetchPriority, size_t, uint64_t>;
+
+  void
+  enqueue(Request request, FetchPriority priority, size_t rank);
+
+  void
+  sendQueued();
+
+  void
+  onData(const Name& name, const Interest& interest, const Data& data);
+
+  void
+  onNack(const Name& name, const Interest& interest, const lp::Nack& nack);
+
+  void
+  onTimeout(const Name& name, const Interest& interest);
+
+  void
+  addRttSample(time::nanoseconds rtt);
+
+  void
+  decreaseWindow();
+
+public:
+  const static int MAX_RETRIES = 2;
+
+private:
+  Face& m_face;
+  double m_window;
+  double m_threshold;
+  size_t m_maxWindow;
+  time::steady_clock::TimePoint m_lastDecrease;
+
+  bool m_hasRttSample = false;
+  time::nanoseconds m_srtt;
+  time::nanoseconds m_rttVar;
+
+  uint64_t m_sequence = 0;
+  std::map<QueueKey, Request> m_queue;
+  std::map<Name, QueueKey> m_queuedNames;
+  std::map<Name, InFlightRequest> m_inFlight;
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_SRC_FETCH_SCHEDULER_H_
@@ -0,0 +1,183 @@
+#include "dledger/item-tree.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/util/sha256.hpp>
+
+namespace dledger {
+
+static const std::string ITEM_COMPONENT = "ITEM";
+
+const uint32_t ItemProof::T_ItemTree;
+const uint32_t ItemProof::T_ItemCount;
+const uint32_t ItemProof::T_ItemRoot;
+const uint32_t ItemProof::T_ItemProof;
+const uint32_t ItemProof::T_ItemIndex;
+const uint32_t ItemProof::T_ProofNode;
+
+namespace {
+
+std::vector<ConstBufferPtr>
+computeLeaves(const Block* items, size_t itemCount)
+{
+  std::vector<ConstBufferPtr> leaves;
+  leaves.reserve(itemCount);
+  for (size_t i = 0; i < itemCount; i++) {
+    leaves.push_back(ItemTree::computeLeaf(items[i]));
+  }
+  return leaves;
+}
+
+std::vector<ConstBufferPtr>
+computeParents(const std::vector<ConstBufferPtr>& level)
+{
+  std::vector<ConstBufferPtr> parents;
+  parents.reserve((level.size() + 1) / 2);
+  for (size_t i = 0; i + 1 < level.size(); i += 2) {
+    parents.push_back(ItemTree::computeNode(*level[i], *level[i + 1]));
+  }
+  if (level.size() % 2 == 1) {
+    parents.push_back(level.back());
+  }
+  return parents;
+}
+
+} // namespace
+
+ConstBufferPtr
+ItemTree::computeRoot(const Block* items, size_t itemCount)
+{
+  if (itemCount == 0) {
+    return util::Sha256().computeDigest();
+  }
+  auto level = computeLeaves(items, itemCount);
+  while (level.size() > 1) {
+    level = computeParents(level);
+  }
+  return level.front();
+}
+
+ConstBufferPtr
+ItemTree::computeLeaf(const Block& item)
+{
+  static const uint8_t LEAF_PREFIX = 0;
+  util::Sha256 digest;
+  digest.update(&LEAF_PREFIX, 1);
+  digest.update(item.wire(), item.size());
+  return digest.computeDigest();
+}
+
+ConstBufferPtr
+ItemTree::computeNode(const Buffer& left, const Buffer& right)
+{
+  static const uint8_t NODE_PREFIX = 1;
+  util::Sha256 digest;
+  digest.update(&NODE_PREFIX, 1);
+  digest.update(left.data(), left.size());
+  digest.update(right.data(), right.size());
+  return digest.computeDigest();
+}
+
+ItemProof::ItemProof(const Block* items, size_t itemCount, size_t index)
+    : m_index(index)
+{
+  if (index >= itemCount) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Item index out of range"));
+  }
+  auto level = computeLeaves(items, itemCount);
+  while (level.size() > 1) {
+    size_t sibling = index ^ 1;
+    if (sibling < level.size()) {
+      m_path.push_back(level[sibling]);
+    }
+    level = computeParents(level);
+    index /= 2;
+  }
+}
+
+ItemProof::ItemProof(const Block& wire)
+{
+  wireDecode(wire);
+}
+
+bool
+ItemProof::verify(const Block& item, size_t itemCount, const Buffer& root) const
+{
+  if (m_index >= itemCount) {
+    return false;
+  }
+  auto node = ItemTree::computeLeaf(item);
+  auto sibling = m_path.begin();
+  size_t index = m_index;
+  for (size_t levelSize = itemCount; levelSize > 1; levelSize = (levelSize + 1) / 2, index /= 2) {
+    if ((index ^ 1) >= levelSize) {
+      // the last node of the level moves up as it is
+      continue;
+    }
+    if (sibling == m_path.end()) {
+      return false;
+    }
+    node = index % 2 == 0 ? ItemTree::computeNode(*node, **sibling) : ItemTree::computeNode(**sibling, *node);
+    ++sibling;
+  }
+  return sibling == m_path.end() && *node == root;
+}
+
+Block
+ItemProof::wireEncode() const
+{
+  auto wire = makeEmptyBlock(T_ItemProof);
+  wire.push_back(makeNonNegativeIntegerBlock(T_ItemIndex, m_index));
+  for (const auto& node : m_path) {
+    wire.push_back(makeBinaryBlock(T_ProofNode, node->data(), node->size()));
+  }
+  wire.encode();
+  return wire;
+}
+
+void
+ItemProof::wireDecode(const Block& wire)
+{
+  if (wire.type() != T_ItemProof) {
+    BOOST_THROW_EXCEPTION(tlv::Error("Bad item proof type"));
+  }
+  wire.parse();
+  auto element = wire.elements_begin();
+  if (element == wire.elements_end() || element->type() != T_ItemIndex) {
+    BOOST_THROW_EXCEPTION(tlv::Error("Missing item index"));
+  }
+  m_index = readNonNegativeInteger(*element);
+  m_path.clear();
+  for (++element; element != wire.elements_end(); ++element) {
+    if (element->type() != T_ProofNode || element->value_size() != util::Sha256::DIGEST_SIZE) {
+      BOOST_THROW_EXCEPTION(tlv::Error("Bad proof node"));
+    }
+    m_path.push_back(make_shared<Buffer>(element->value(), element->value_size()));
+  }
+}
+
+Name
+ItemProof::makeItemName(const Name& recordName, size_t index)
+{
+  return Name(recordName).append(ITEM_COMPONENT).appendNumber(index);
+}
+
+bool
+ItemProof::isItemName(const Name& name)
+{
+  return name.size() >= 3 && name.get(-1).isNumber() &&
+         name.get(-2).isGeneric() && readString(name.get(-2)) == ITEM_COMPONENT &&
+         name.get(-3).isImplicitSha256Digest();
+}
+
+bool
+ItemProof::parseItemName(const Name& name, Name& recordName, size_t& index)
+{
+  if (!isItemName(name)) {
+    return false;
+  }
+  recordName = name.getPrefix(-2);
+  index = name.get(-1).toNumber();
+  return true;
+}
+
+} // namespace dledger
@@ -13,6 +13,11 @@
 using namespace ndn;
 namespace dledger {
 
+static const size_t MAX_REJECTED_RECORDS = 4096;
+// the backoff of fetching a body segment again once the fetch scheduler gives up
+static const time::milliseconds BODY_RETRY_INTERVAL(1000);
+static const time::milliseconds MAX_BODY_RETRY_INTERVAL(60000);
+
 int max(int a, int b) {
     return a > b ? a : b;
 }
@@ -36,6 +41,9 @@ LedgerImpl::LedgerImpl(const Config& config,
     , m_network(network)
     , m_scheduler(network.getIoService())
     , m_backend(config.databasePath)
+    , m_fetchScheduler(network, config.initialFetchWindow, config.maxFetchWindow)
+    , m_verificationPool(network.getIoService(), config.verificationThreads,
+                         bind(&LedgerImpl::verifyRecordSignatures, this, _1))
 {
   std::cout << "\nDLedger Initialization Start" << std::endl;
 
@@ -63,12 +71,12 @@ LedgerImpl::LedgerImpl(const Config& config,
     GenesisRecord genesisRecord((std::to_string(i)));
     RecordName recordName = RecordName::generateRecordName(config, genesisRecord);
     auto data = make_shared<Data>(recordName);
-    auto contentBlock = makeEmptyBlock(tlv::Content);
-    genesisRecord.wireEncode(contentBlock);
-    data->setContent(contentBlock);
+    data->setContent(genesisRecord.wireEncode());
     m_keychain.sign(*data, signingWithSha256());
     genesisRecord.m_data = data;
-    addToTailingRecord(genesisRecord, true);
+    genesisRecord.m_producerPrefix = recordName.getProducerPrefix();
+    genesisRecord.m_generationTimestamp = recordName.getGenerationTimestamp();
+    addToTailingRecord(make_shared<Record>(std::move(genesisRecord)), true);
   }
   std::cout << "STEP 2" << std::endl
             << "- " << m_config.numGenesisBlock << " genesis records have been added to the DLedger" << std::endl
@@ -80,10 +88,36 @@ LedgerImpl::LedgerImpl(const Config& config,
 LedgerImpl::~LedgerImpl()
 {
     if (m_syncEventID) m_syncEventID.cancel();
+    if (m_submissionEventID) m_submissionEventID.cancel();
 }
 
 ReturnCode
 LedgerImpl::createRecord(Record& record)
+{
+  return announceNewRecord(appendNewRecord(record, false));
+}
+
+ReturnCode
+LedgerImpl::createRecord(Record&& record)
+{
+  return announceNewRecord(appendNewRecord(record, true));
+}
+
+ReturnCode
+LedgerImpl::announceNewRecord(ReturnCode appended)
+{
+  if (!appended.success()) {
+    return appended;
+  }
+  //send sync interest
+  auto rc = sendSyncInterest();
+  if (rc.success())
+    return appended;
+  else return rc;
+}
+
+ReturnCode
+LedgerImpl::appendNewRecord(Record& record, bool isMovable)
 {
   std::cout << "[LedgerImpl::addRecord] Add new record" << std::endl;
   if (m_tailRecords.empty()) {
@@ -96,23 +130,27 @@ LedgerImpl::createRecord(Record& record)
       return ReturnCode::timingError("record generation too fast");
   }
 
-  if (record.getType() == CERTIFICATE_RECORD) {
+  // a record passed by reference is only changed once it is appended, so that the caller can retry after an error
+  Record copy;
+  Record& newRecord = isMovable ? record : (copy = record);
+
+  if (newRecord.getType() == CERTIFICATE_RECORD) {
       for (const auto& certName: m_lastCertRecords) {
           std::cout << "-- Certificate record: Add previous cert record: " << certName << std::endl;
-          record.addRecordItem(KeyLocator(certName).wireEncode());
+          newRecord.addRecordItem(KeyLocator(certName).wireEncode());
       }
   }
 
   std::vector<Name> recordPeerList;
-  std::map<Name, std::vector<RecordName>> recordList;
+  std::map<Name, std::vector<Name>> recordList;
   int recordCount = 0;
   for (const auto &item : m_tailRecords) {
       if (item.second.refSet.size() <= m_config.appendWeight &&
-            m_config.peerPrefix != RecordName(item.first).getProducerPrefix() &&
             item.second.referenceVerified) {
-          auto rName = RecordName(item.first);
-          recordList[rName.getProducerPrefix()].emplace_back(rName);
-          recordPeerList.emplace_back(rName.getProducerPrefix());
+          const auto& producerPrefix = item.second.record->getProducerPrefix();
+          if (producerPrefix == m_config.peerPrefix) continue;
+          recordList[producerPrefix].emplace_back(item.first);
+          recordPeerList.emplace_back(producerPrefix);
           recordCount ++;
       }
   }
@@ -128,68 +166,225 @@ LedgerImpl::createRecord(Record& record)
   if (recordCount < m_config.precedingRecordNum) {
       return ReturnCode::notEnoughTailingRecord();
   }
-  while (record.getPointersFromHeader().size() < m_config.precedingRecordNum) {
+  while (newRecord.getPointersFromHeader().size() < m_config.precedingRecordNum) {
       for (const auto &tailRecordPeer : recordPeerList) {
           auto& list = recordList.at(tailRecordPeer);
           if (list.empty()) continue;
-          record.addPointer(*list.begin());
+          newRecord.addPointer(*list.begin());
           list.erase(list.begin());
           recordCount --;
-          if (record.getPointersFromHeader().size() >= m_config.precedingRecordNum)
+          if (newRecord.getPointersFromHeader().size() >= m_config.precedingRecordNum)
               break;
       }
   }
 
-  Name dataName = RecordName::generateRecordName(m_config, record);
+  RecordName dataName = RecordName::generateRecordName(m_config, newRecord);
+
+  // a body which does not fit into one packet goes into segments listed in the header
+  auto bodySegments = newRecord.makeBodySegments(dataName);
+  if (bodySegments.size() > Record::MAX_BODY_SEGMENTS) {
+    return ReturnCode::recordTooLarge();
+  }
+  for (const auto& segment : bodySegments) {
+    m_keychain.sign(*segment, signingWithSha256());
+  }
+  newRecord.setBodySegments(bodySegments);
+
   auto data = make_shared<Data>(dataName);
-  auto contentBlock = makeEmptyBlock(tlv::Content);
-  record.wireEncode(contentBlock);
-  data->setContent(contentBlock);
+  data->setContent(newRecord.wireEncode());
   data->setFreshnessPeriod(time::minutes(5));
 
   // sign the packet with peer's key
   try {
-    m_keychain.sign(*data, security::signingByIdentity(m_config.peerPrefix));
+    m_keychain.sign(*data, getSigningInfo());
   }
   catch (const std::exception& e) {
+    resetSigningInfo();
     return ReturnCode::signingError(e.what());
   }
-  record.m_data = data;
+  newRecord.m_data = data;
+  newRecord.m_producerPrefix = dataName.getProducerPrefix();
+  newRecord.m_generationTimestamp = dataName.getGenerationTimestamp();
+  for (const auto& segment : bodySegments) {
+    m_backend.putRecord(segment);
+  }
+  m_lastRecordCreation = time::steady_clock::now();
   std::cout << "- Finished the generation of the new record:" << std::endl
             << "Name: " << data->getFullName().toUri() << std::endl;
 
   // add new record into the ledger
-  addToTailingRecord(record, true);
+  if (!isMovable) {
+    record = newRecord;
+  }
+  addToTailingRecord(make_shared<Record>(std::move(newRecord)), true);
+  return ReturnCode::noError(data->getFullName().toUri());
+}
 
-  //send sync interest
-  auto rc = sendSyncInterest();
-  if (rc.success())
-    return ReturnCode::noError(data->getFullName().toUri());
-  else return rc;
+void
+LedgerImpl::submitRecordItem(const Block& item, const OnRecordItemSubmitted& onSubmitted)
+{
+  if (m_submissions.size() >= m_config.submissionQueueLimit) {
+    onSubmitted(ReturnCode::submissionQueueFull());
+    return;
+  }
+  Submission submission{item, onSubmitted};
+  if (!submission.item.hasWire()) {
+    submission.item.encode();
+  }
+  m_submissions.push_back(std::move(submission));
+  scheduleSubmissions();
+}
+
+void
+LedgerImpl::scheduleSubmissions()
+{
+  if (m_submissions.empty() || m_submissionEventID) {
+    return;
+  }
+  auto nextSlot = m_lastRecordCreation + m_config.recordProductionRateLimit;
+  auto now = time::steady_clock::now();
+  auto delay = nextSlot > now ? time::duration_cast<time::milliseconds>(nextSlot - now) : time::milliseconds(0);
+  m_submissionEventID = m_scheduler.schedule(delay, [this] { produceSubmittedRecord(); });
+}
+
+void
+LedgerImpl::produceSubmittedRecord()
+{
+  m_submissionEventID = scheduler::EventId();
+  if (m_submissions.empty()) {
+    return;
+  }
+  // the items of the record, at least one even if it needs a segmented body
+  Record record(RecordType::GENERIC_RECORD, "submitted-" + std::to_string(m_randomEngine()));
+  size_t itemNum = 0;
+  size_t itemsSize = 0;
+  for (const auto& submission : m_submissions) {
+    size_t size = itemsSize + submission.item.size();
+    if (itemNum > 0 && 1 + tlv::sizeOfVarNumber(size) + size > Record::BODY_SEGMENT_SIZE) {
+      break;
+    }
+    record.addRecordItem(submission.item);
+    itemsSize = size;
+    itemNum++;
+  }
+  if (itemNum > 1) {
+    // the submitters can read their own items without the whole record
+    record.addItemTree();
+  }
+
+  auto result = appendNewRecord(record, true);
+  if (result.code() == EC_TimingError || result.code() == EC_NoTailingRecord ||
+      result.code() == EC_NotEnoughTailingRecord) {
+    std::cout << "- Submitted record delayed : " << result.what() << std::endl;
+    m_submissionEventID = m_scheduler.schedule(m_config.recordProductionRateLimit,
+                                               [this] { produceSubmittedRecord(); });
+    return;
+  }
+  if (result.success()) {
+    // the items are in the ledger even if the record cannot be announced now
+    auto syncResult = sendSyncInterest();
+    if (!syncResult.success()) {
+      std::cout << "- SYNC Interest for the submitted record failed : " << syncResult.what() << std::endl;
+    }
+  }
+  std::vector<Submission> done(std::make_move_iterator(m_submissions.begin()),
+                               std::make_move_iterator(m_submissions.begin() + itemNum));
+  m_submissions.erase(m_submissions.begin(), m_submissions.begin() + itemNum);
+  for (const auto& submission : done) {
+    submission.onSubmitted(result);
+  }
+  scheduleSubmissions();
+}
+
+BlobReference
+LedgerImpl::putBlob(const uint8_t* content, size_t size)
+{
+  auto reference = BlobReference::fromContent(content, size);
+  if (!m_backend.hasBlob(reference.getDigest())) {
+    m_backend.putBlob(reference.getDigest(), content, size);
+  }
+  return reference;
+}
+
+ConstBufferPtr
+LedgerImpl::getBlob(const BlobReference& reference) const
+{
+  return m_backend.getBlob(reference.getDigest());
 }
 
 optional<Record>
 LedgerImpl::getRecord(const std::string& recordName) const
+{
+  auto record = getSharedRecord(recordName);
+  if (record == nullptr) {
+    return nullopt;
+  }
+  return *record;
+}
+
+shared_ptr<const Record>
+LedgerImpl::getSharedRecord(const std::string& recordName) const
 {
   std::cout << "getRecord Called \n";
   Name rName = recordName;
-  if (m_tailRecords.count(rName) && !m_tailRecords.find(rName)->second.referenceVerified) {
-      return nullopt;
+  auto tailRecord = m_tailRecords.find(rName);
+  if (tailRecord != m_tailRecords.end()) {
+    if (!tailRecord->second.referenceVerified) {
+      return nullptr;
+    }
+    // the tailing records are kept decoded, with their body unless it is in segments
+    const auto& record = tailRecord->second.record;
+    if (!record->hasSegmentedBody() || !record->getRecordItems().empty()) {
+      return record;
+    }
   }
-  auto dataPtr = m_backend.getRecord(rName);
-  if (dataPtr != nullptr) {
-    return Record(dataPtr);
+  auto record = loadRecord(rName);
+  if (!record) {
+    return nullptr;
   }
-  else {
+  return make_shared<const Record>(std::move(*record));
+}
+
+optional<Record>
+LedgerImpl::loadRecord(const Name& recordName) const
+{
+  auto dataPtr = m_backend.getRecord(recordName);
+  if (dataPtr == nullptr) {
+    return nullopt;
+  }
+  Record record(dataPtr);
+  if (record.hasSegmentedBody() && !loadRecordBody(record)) {
     return nullopt;
   }
+  return record;
+}
+
+bool
+LedgerImpl::loadRecordBody(Record& record) const
+{
+  std::vector<shared_ptr<const Data>> segments;
+  for (const auto& segmentName : record.getBodySegmentNames()) {
+    auto segment = m_backend.getRecord(segmentName);
+    if (segment == nullptr) {
+      return false;
+    }
+    segments.push_back(segment);
+  }
+  try {
+    record.decodeBodySegments(segments);
+    record.checkItemTree();
+  }
+  catch (const std::exception& e) {
+    std::cout << "- Bad record body because " << e.what() << std::endl;
+    return false;
+  }
+  return true;
 }
 
 bool
 LedgerImpl::hasRecord(const std::string& recordName) const
 {
-  auto dataPtr = m_backend.getRecord(Name(recordName));
-  return dataPtr != nullptr;
+  return m_backend.hasRecord(Name(recordName));
 }
 
 std::list<Name>
@@ -197,6 +392,8 @@ LedgerImpl::listRecord(const std::string& prefix) const
 {
     auto list = m_backend.listRecord(Name(prefix));
     list.remove_if([&](const auto& name) {return m_tailRecords.count(name) && !m_tailRecords.find(name)->second.referenceVerified;});
+    // body segments are stored along with the records
+    list.remove_if([](const auto& name) {return name.size() > 1 && name.get(-2).isSegment();});
     return list;
 }
 
@@ -216,9 +413,6 @@ ReturnCode LedgerImpl::sendSyncInterest() {
     std::cout << "[LedgerImpl::sendSyncInterest] Send SYNC Interest.\n";
     // SYNC Interest Name: /<multicastPrefix>/SYNC/digest
     // construct SYNC Interest
-    Name syncInterestName = m_config.multicastPrefix;
-    syncInterestName.append("SYNC");
-    Interest syncInterest(syncInterestName);
     Block appParam = makeEmptyBlock(tlv::ApplicationParameters);
     for (const auto &certName: m_lastCertRecords) {
         appParam.push_back(KeyLocator(certName).wireEncode());
@@ -227,17 +421,30 @@ ReturnCode LedgerImpl::sendSyncInterest() {
         if (item.second.referenceVerified && item.second.refSet.empty())
             appParam.push_back(item.first.wireEncode());
     }
-    appParam.parse();
-    syncInterest.setApplicationParameters(appParam);
-    syncInterest.setCanBePrefix(false);
-    syncInterest.setMustBeFresh(true);
-    try {
-        m_keychain.sign(syncInterest, signingByIdentity(m_config.peerPrefix));
-    } catch (const std::exception& e) {
-        return ReturnCode::signingError(e.what());
+    appParam.encode();
+    if (m_syncInterest != nullptr && m_syncAppParam == appParam) {
+        // the tailing records are unchanged, the signed Interest only needs a new nonce
+        m_syncInterest->refreshNonce();
+    }
+    else {
+        Name syncInterestName = m_config.multicastPrefix;
+        syncInterestName.append("SYNC");
+        auto syncInterest = make_shared<Interest>(syncInterestName);
+        appParam.parse();
+        syncInterest->setApplicationParameters(appParam);
+        syncInterest->setCanBePrefix(false);
+        syncInterest->setMustBeFresh(true);
+        try {
+            m_keychain.sign(*syncInterest, getSigningInfo());
+        } catch (const std::exception& e) {
+            resetSigningInfo();
+            return ReturnCode::signingError(e.what());
+        }
+        m_syncInterest = syncInterest;
+        m_syncAppParam = appParam;
     }
     // nullptrs for data and timeout callbacks because a sync Interest is not expecting a Data back
-    m_network.expressInterest(syncInterest, nullptr,
+    m_network.expressInterest(*m_syncInterest, nullptr,
                               bind(&LedgerImpl::onNack, this, _1, _2), nullptr);
 
 
@@ -248,49 +455,61 @@ ReturnCode LedgerImpl::sendSyncInterest() {
 }
 
 bool
-LedgerImpl::checkSyntaxValidityOfRecord(const Data& data) {
-    std::cout << "[LedgerImpl::checkSyntaxValidityOfRecord] Check the format validity of the record" << std::endl;
+LedgerImpl::checkPolicyOfRecord(const Record& dataRecord) const {
+    std::cout << "[LedgerImpl::checkPolicyOfRecord] Check the record before its signature" << std::endl;
     std::cout << "- Step 1: Check whether it is a valid record following DLedger record spec" << std::endl;
-    Record dataRecord;
     try {
-        // format check
-        dataRecord = Record(data);
+        // format check, the record itself is decoded already
         dataRecord.checkPointerCount(m_config.precedingRecordNum);
+        if (!dataRecord.hasSegmentedBody()) {
+            // a segmented body is checked when it is loaded
+            dataRecord.checkItemTree();
+        }
     } catch (const std::exception &e) {
         std::cout << "-- The Data format is not proper for DLedger record because " << e.what() << std::endl;
         return false;
     }
 
-    std::cout << "- Step 2: Check signature" << std::endl;
-    Name producerID = dataRecord.getProducerPrefix();
-    if (!m_config.certificateManager->verifySignature(data)) {
-        std::cout << "-- Bad Signature." << std::endl;
-        return false;
-    }
-
-    std::cout << "- Step 3: Check rating limit" << std::endl;
+    std::cout << "- Step 2: Check rating limit" << std::endl;
+    const Name& producerID = dataRecord.getProducerPrefix();
     auto tp = dataRecord.getGenerationTimestamp();
     if (tp > time::system_clock::now() + m_config.clockSkewTolerance) {
         std::cout << "-- record from too far in the future" << std::endl;
         return false;
     }
-    if (m_rateCheck.find(producerID) == m_rateCheck.end()) {
-        m_rateCheck[producerID] = tp;
-    } else {
-        if ((time::abs(tp - m_rateCheck.at(producerID)) < m_config.recordProductionRateLimit)) {
-            std::cout << "-- record generation too fast from the peer" << std::endl;
-            return false;
-        }
+    auto lastRecord = m_rateCheck.find(producerID);
+    if (lastRecord != m_rateCheck.end() &&
+        time::abs(tp - lastRecord->second) < m_config.recordProductionRateLimit) {
+        std::cout << "-- record generation too fast from the peer" << std::endl;
+        return false;
     }
 
-    std::cout << "- Step 4: Check InterLock Policy" << std::endl;
+    std::cout << "- Step 3: Check InterLock Policy" << std::endl;
     for (const auto &precedingRecordName : dataRecord.getPointersFromHeader()) {
-        std::cout << "-- Preceding record from " << RecordName(precedingRecordName).getProducerPrefix() << '\n';
-        if (RecordName(precedingRecordName).getProducerPrefix() == producerID) {
+        std::cout << "-- Preceding record " << precedingRecordName << '\n';
+        if (RecordName::isProducedBy(precedingRecordName, producerID)) {
             std::cout << "--- From itself" << '\n';
             return false;
         }
     }
+    return true;
+}
+
+bool
+LedgerImpl::checkSyntaxValidityOfRecord(const Record& dataRecord, bool signatureValid) {
+    std::cout << "[LedgerImpl::checkSyntaxValidityOfRecord] Check the format validity of the record" << std::endl;
+    // checked before the signature already, but the rate limit may have changed meanwhile
+    if (!checkPolicyOfRecord(dataRecord)) {
+        return false;
+    }
+
+    std::cout << "- Step 4: Check signature" << std::endl;
+    if (!signatureValid) {
+        std::cout << "-- Bad Signature." << std::endl;
+        return false;
+    }
+    // only a signed record starts the rate limit of its producer
+    m_rateCheck.emplace(dataRecord.getProducerPrefix(), dataRecord.getGenerationTimestamp());
 
     std::cout << "- Step 5: Check certificate/revocation record format" << std::endl;
     if (dataRecord.getType() == CERTIFICATE_RECORD || dataRecord.getType() == REVOCATION_RECORD) {
@@ -306,19 +525,49 @@ LedgerImpl::checkSyntaxValidityOfRecord(const Data& data) {
     return true;
 }
 
-bool LedgerImpl::checkEndorseValidityOfRecord(const Data& data) {
-    std::cout << "[LedgerImpl::checkEndorseValidityOfRecord] Check the reference validity of the record" << std::endl;
-    Record dataRecord;
+std::vector<VerificationResult>
+LedgerImpl::verifyRecordSignatures(const std::vector<shared_ptr<const Data>>& records) const
+{
+  std::vector<VerificationResult> results(records.size());
+  std::shared_lock<std::shared_timed_mutex> lock(m_certificateMutex);
+  std::vector<bool> signatureValid;
+  try {
+    signatureValid = m_config.certificateManager->verifySignatures(records);
+  } catch (const std::exception& e) {
+    // verify one by one to single out the bad record
+  }
+  for (size_t i = 0; i < records.size(); i++) {
     try {
-        // format check
-        dataRecord = Record(data);
+      results[i].signatureValid = signatureValid.size() == records.size() ?
+                                  signatureValid[i] : m_config.certificateManager->verifySignature(*records[i]);
+      // verified signatures are remembered, the endorsement only checks for revocation
+      results[i].endorsed = results[i].signatureValid &&
+                            m_config.certificateManager->endorseSignature(*records[i]);
     } catch (const std::exception& e) {
-        std::cout << "-- The Data format is not proper for DLedger record because " << e.what() << std::endl;
-        return false;
+      results[i].signatureValid = false;
+      results[i].endorsed = false;
     }
+  }
+  return results;
+}
+
+bool LedgerImpl::checkEndorseValidityOfRecord(const Record& dataRecord) {
+    std::cout << "[LedgerImpl::checkEndorseValidityOfRecord] Check the reference validity of the record" << std::endl;
+    const Data& data = *dataRecord.m_data;
 
     std::cout << "- Step 6: Check Revocation" << std::endl;
-    if (!m_config.certificateManager->endorseSignature(data)) {
+    // reuse the result of the verification threads unless the certificates changed since
+    bool endorsed;
+    auto endorsement = m_endorsements.find(dataRecord.getRecordName());
+    if (endorsement != m_endorsements.end() && endorsement->second.second == m_certificateEpoch) {
+        endorsed = endorsement->second.first;
+    } else {
+        endorsed = m_config.certificateManager->endorseSignature(data);
+    }
+    if (endorsement != m_endorsements.end()) {
+        m_endorsements.erase(endorsement);
+    }
+    if (!endorsed) {
         std::cout << "-- certificate revoked" << std::endl;
         return false;
     }
@@ -332,7 +581,7 @@ bool LedgerImpl::checkEndorseValidityOfRecord(const Data& data) {
                 return false;
             }
         } else {
-            if (m_backend.getRecord(precedingRecordName) != nullptr) {
+            if (m_backend.hasRecord(precedingRecordName)) {
                 std::cout << "-- Preceding record too deep" << '\n';
             } else {
                 std::cout << "-- Preceding record Not found" << '\n';
@@ -362,6 +611,22 @@ LedgerImpl::onLedgerSyncRequest(const Interest& interest)
     return;
   }*/
 
+  const auto& appParam = interest.getApplicationParameters();
+  try {
+    appParam.parse();
+  } catch (const std::exception& e) {
+    std::cout << "- Bad application parameters. " << std::endl;
+    return;
+  }
+
+  // most SYNC Interests carry the tailing records we have already,
+  // verify the signature only if there is something to do
+  if (std::all_of(appParam.elements_begin(), appParam.elements_end(),
+                  [this] (const Block& item) { return isSyncItemKnown(item); })) {
+      std::cout << "- Nothing new. Ignore" << std::endl;
+      return;
+  }
+
   // verify the signature
   if (!m_config.certificateManager->verifySignature(interest)) {
       std::cout << "- Bad Signature. " << std::endl;
@@ -371,8 +636,6 @@ LedgerImpl::onLedgerSyncRequest(const Interest& interest)
   //cancel previous reply
   if (m_replySyncEventID) m_replySyncEventID.cancel();
 
-  const auto& appParam = interest.getApplicationParameters();
-  appParam.parse();
   std::cout << "- Received Tailing Record Names: \n";
   bool shouldSendSync = false;
   bool isCertPending = false;
@@ -384,9 +647,9 @@ LedgerImpl::onLedgerSyncRequest(const Interest& interest)
             if (certName.getRecordType() != CERTIFICATE_RECORD) {
                 BOOST_THROW_EXCEPTION(std::runtime_error(""));
             }
-            if (!m_backend.getRecord(certName)) {
+            if (!m_backend.hasRecord(certName)) {
                 std::cout << "--- Fetch unseen certificate record "<< l.getName() << std::endl;
-                fetchRecord(certName);
+                fetchRecord(certName, FetchPriority::CERTIFICATE);
                 isCertPending = true;
             }
         } catch (const std::exception& e) {
@@ -400,14 +663,17 @@ LedgerImpl::onLedgerSyncRequest(const Interest& interest)
     if (m_tailRecords.count(recordName) != 0 && m_tailRecords[recordName].refSet.empty()) {
       std::cout << "--- This record is already in our tailing records \n";
     }
-    else if (m_backend.getRecord(recordName)) {
+    else if (m_backend.hasRecord(recordName)) {
       std::cout << "--- This record is already in our Ledger but not tailing any more \n";
       shouldSendSync = true;
     }
+    else if (isRecentlyRejected(recordName)) {
+      std::cout << "--- This record is a known bad record \n";
+    }
     else {
         std::cout << "--- Fetch unseen tailing record \n";
         //fetch record
-        fetchRecord(recordName);
+        fetchRecord(recordName, FetchPriority::TIP);
     }
   }
   if (shouldSendSync) {
@@ -419,9 +685,46 @@ LedgerImpl::onLedgerSyncRequest(const Interest& interest)
   }
 }
 
+bool
+LedgerImpl::isSyncItemKnown(const Block& item) const
+{
+  try {
+    if (item.type() == tlv::KeyLocator) {
+      Name certName = KeyLocator(item).getName();
+      return m_backend.hasRecord(certName) || m_fetchScheduler.isPending(certName);
+    }
+    Name recordName(item);
+    auto tailRecord = m_tailRecords.find(recordName);
+    if (tailRecord != m_tailRecords.end() && tailRecord->second.refSet.empty()) {
+      return true;
+    }
+    if (m_backend.hasRecord(recordName)) {
+      // the sender is behind, it needs our SYNC reply
+      return false;
+    }
+    return m_fetchScheduler.isPending(recordName) || m_badRecords.count(recordName) != 0 ||
+           isRecentlyRejected(recordName) || findInSyncStack(recordName) != nullptr;
+  } catch (const std::exception& e) {
+    // ignored by the handler as well
+    return true;
+  }
+}
+
 void
 LedgerImpl::onRecordRequest(const Interest& interest)
 {
+  if (RecordBatch::isBatchName(interest.getName())) {
+    onBatchRequest(interest);
+    return;
+  }
+  if (ItemProof::isItemName(interest.getName())) {
+    onItemRequest(interest);
+    return;
+  }
+  if (BlobReference::isBlobName(interest.getName())) {
+    onBlobRequest(interest);
+    return;
+  }
   std::cout << "[LedgerImpl::onRecordRequest] Receive Interest to Fetch Record" << std::endl;
   auto desiredData = m_backend.getRecord(interest.getName().toUri());
   if (desiredData) {
@@ -431,95 +734,771 @@ LedgerImpl::onRecordRequest(const Interest& interest)
 }
 
 void
-LedgerImpl::fetchRecord(const Name& recordName)
+LedgerImpl::onItemRequest(const Interest& interest)
+{
+  std::cout << "[LedgerImpl::onItemRequest] Receive Interest to Fetch Record Item" << std::endl;
+  Name recordName;
+  size_t index = 0;
+  if (!ItemProof::parseItemName(interest.getName(), recordName, index)) {
+    std::cout << "- Bad item name. Ignore" << std::endl;
+    return;
+  }
+  shared_ptr<Data> itemData;
+  try {
+    // the names of stored segments end with a digest too, but they are not records
+    RecordName::parse(recordName);
+    auto record = getSharedRecord(recordName.toUri());
+    if (record == nullptr || !record->hasItemTree() || index >= record->getRecordItems().size()) {
+      std::cout << "- No such item. Ignore" << std::endl;
+      return;
+    }
+    itemData = record->makeItemData(index);
+  }
+  catch (const std::exception& e) {
+    std::cout << "- Bad item request because " << e.what() << std::endl;
+    return;
+  }
+  m_keychain.sign(*itemData, signingWithSha256());
+  m_network.put(*itemData);
+}
+
+void
+LedgerImpl::onBlobRequest(const Interest& interest)
+{
+  std::cout << "[LedgerImpl::onBlobRequest] Receive Interest to Fetch Blob Segment" << std::endl;
+  ConstBufferPtr digest;
+  size_t segment = 0;
+  if (!BlobReference::parseBlobName(interest.getName(), digest, segment)) {
+    std::cout << "- Bad blob segment name. Ignore" << std::endl;
+    return;
+  }
+  auto blob = m_backend.getBlob(*digest);
+  if (blob == nullptr) {
+    std::cout << "- No such blob. Ignore" << std::endl;
+    return;
+  }
+  BlobReference reference(digest, blob->size());
+  // checked before computing the offset, which would overflow for a huge segment number
+  if (segment >= reference.getSegmentCount()) {
+    std::cout << "- No such blob segment. Ignore" << std::endl;
+    return;
+  }
+  size_t offset = segment * BlobReference::SEGMENT_SIZE;
+  auto data = make_shared<Data>(interest.getName());
+  data->setContent(blob->data() + offset, std::min(BlobReference::SEGMENT_SIZE, blob->size() - offset));
+  data->setFinalBlock(name::Component::fromSegment(reference.getSegmentCount() - 1));
+  data->setFreshnessPeriod(time::minutes(5));
+  m_keychain.sign(*data, signingWithSha256());
+  m_network.put(*data);
+}
+
+void
+LedgerImpl::referenceBlobs(const Record& record)
+{
+  // the body of a received record in segments is not decoded in the tailing record
+  optional<Record> withBody;
+  if (record.hasSegmentedBody() && record.getRecordItems().empty()) {
+    withBody = record;
+    if (!loadRecordBody(*withBody)) {
+      return;
+    }
+  }
+  for (const auto& item : (withBody ? *withBody : record).getRecordItems()) {
+    if (!BlobReference::isBlobReference(item)) {
+      continue;
+    }
+    try {
+      BlobReference reference(item);
+      // the size comes from the producer, it bounds the memory and the Interests of fetching
+      if (reference.getSize() > m_config.maxBlobSize) {
+        std::cout << "- Blob of " << reference.getSize() << " bytes above the maximum size. Ignore" << std::endl;
+        continue;
+      }
+      m_backend.addBlobReference(reference.getDigest());
+      fetchBlob(reference, record.getProducerPrefix());
+    }
+    catch (const std::exception& e) {
+      std::cout << "- Bad blob reference because " << e.what() << std::endl;
+    }
+  }
+}
+
+void
+LedgerImpl::fetchBlob(const BlobReference& reference, const Name& peerPrefix)
+{
+  if (m_backend.hasBlob(reference.getDigest())) {
+    return;
+  }
+  for (const auto& pending : m_pendingBlobs) {
+    if (pending.second.reference.getDigest() == reference.getDigest()) {
+      return;
+    }
+  }
+  if (reference.getSize() == 0) {
+    if (reference.matches(Buffer())) {
+      m_backend.putBlob(reference.getDigest(), nullptr, 0);
+    }
+    return;
+  }
+  Name blobName = reference.makeBlobName(peerPrefix);
+  size_t segmentNum = reference.getSegmentCount();
+  m_pendingBlobs.emplace(blobName, PendingBlob{reference, std::vector<Block>(segmentNum), segmentNum});
+  std::cout << "- Fetch blob " << blobName << " in " << segmentNum << " segments" << std::endl;
+  for (size_t i = 0; i < segmentNum; i++) {
+    Interest interestForSegment(Name(blobName).appendSegment(i));
+    interestForSegment.setCanBePrefix(false);
+    interestForSegment.setMustBeFresh(true);
+    // blobs wait for the records, nothing waits for blobs in the ledger
+    m_fetchScheduler.fetch(interestForSegment, FetchPriority::BACKGROUND, i,
+                           bind(&LedgerImpl::onFetchedBlobSegment, this, _1, _2),
+                           [this, blobName] (const Interest& interest) {
+                             std::cout << "- Give up fetching blob segment " << interest.getName() << std::endl;
+                             // fetched again with the next record referencing it
+                             m_pendingBlobs.erase(blobName);
+                           });
+  }
+}
+
+void
+LedgerImpl::onFetchedBlobSegment(const Interest& interest, const Data& data)
+{
+  auto it = m_pendingBlobs.find(interest.getName().getPrefix(-1));
+  if (it == m_pendingBlobs.end()) {
+    return;
+  }
+  auto& pending = it->second;
+  size_t segment = interest.getName().get(-1).toSegment();
+  if (pending.segments.at(segment).isValid()) {
+    return;
+  }
+  pending.segments[segment] = data.getContent();
+  if (--pending.missingSegments > 0) {
+    return;
+  }
+  // the segments are not signed by the producer, the digest in the signed record covers them
+  Buffer content;
+  content.reserve(pending.reference.getSize());
+  for (const auto& segmentContent : pending.segments) {
+    content.insert(content.end(), segmentContent.value_begin(), segmentContent.value_end());
+  }
+  if (pending.reference.matches(content)) {
+    m_backend.putBlob(pending.reference.getDigest(), content.data(), content.size());
+    std::cout << "[LedgerImpl::onFetchedBlobSegment] fetched blob " << it->first << std::endl;
+  }
+  else {
+    std::cout << "[LedgerImpl::onFetchedBlobSegment] blob " << it->first << " does not match its digest" << std::endl;
+  }
+  m_pendingBlobs.erase(it);
+}
+
+void
+LedgerImpl::onBatchRequest(const Interest& interest)
+{
+  std::cout << "[LedgerImpl::onBatchRequest] Receive Interest to Fetch Record Batch" << std::endl;
+  Name batchName = interest.getName();
+  uint64_t segment = 0;
+  if (batchName.get(-1).isSegment()) {
+    segment = batchName.get(-1).toSegment();
+    batchName = batchName.getPrefix(-1);
+  }
+
+  auto it = m_batchSegments.find(batchName);
+  if (it == m_batchSegments.end()) {
+    size_t depth;
+    std::vector<Name> roots;
+    if (!RecordBatch::parseBatchName(batchName, depth, roots)) {
+      std::cout << "- Bad batch name. Ignore" << std::endl;
+      return;
+    }
+    // every new batch is collected and signed, so the requesters share a bounded amount of work
+    if (m_batchSegments.size() >= m_config.batchServeLimit || m_batchSegmentsSize >= m_config.batchServeMaxSize) {
+      std::cout << "- Too many batches being served. Ignore" << std::endl;
+      return;
+    }
+    depth = std::min(depth, m_config.batchServeMaxDepth);
+    auto ancestors = RecordBatch::collectAncestors(m_backend, roots, depth, m_config.batchMaxRecords);
+    auto segments = RecordBatch::makeSegments(batchName, ancestors);
+    size_t batchSize = 0;
+    for (const auto& segmentData : segments) {
+      m_keychain.sign(*segmentData, signingWithSha256());
+      batchSize += segmentData->wireEncode().size();
+    }
+    std::cout << "- Collected " << ancestors.size() << " records in " << segments.size() << " segments" << std::endl;
+    it = m_batchSegments.emplace(batchName, std::move(segments)).first;
+    m_batchSegmentsSize += batchSize;
+    // keep the segments while they are fresh
+    m_scheduler.schedule(time::seconds(10), [this, batchName, batchSize] {
+      m_batchSegments.erase(batchName);
+      m_batchSegmentsSize -= batchSize;
+    });
+  }
+  if (segment < it->second.size()) {
+    m_network.put(*it->second.at(segment));
+  }
+}
+
+void
+LedgerImpl::fetchRecord(const Name& recordName, FetchPriority priority, size_t rank)
 {
   std::cout << "[LedgerImpl::fetchRecord] Fetch the missing record" << std::endl;
+  if (isRecentlyRejected(recordName)) {
+    std::cout << "- Known bad record. Ignore" << std::endl;
+    return;
+  }
+  try {
+    if (RecordName::parse(recordName).recordType == CERTIFICATE_RECORD) {
+      priority = FetchPriority::CERTIFICATE;
+    }
+  } catch (const std::exception& e) {
+    // not a record name, fetched anyway
+  }
   Interest interestForRecord(recordName);
   interestForRecord.setCanBePrefix(false);
   interestForRecord.setMustBeFresh(true);
-  std::cout << "- Sending Record Fetching Interest " << interestForRecord.getName().toUri() << std::endl;
-  m_network.expressInterest(interestForRecord,
-                            bind(&LedgerImpl::onFetchedRecord, this, _1, _2),
-                            bind(&LedgerImpl::onNack, this, _1, _2),
-                            bind(&LedgerImpl::onTimeout, this, _1));
+  std::cout << "- Queue Record Fetching Interest " << interestForRecord.getName().toUri() << std::endl;
+  m_fetchScheduler.fetch(interestForRecord, priority, rank,
+                         bind(&LedgerImpl::onFetchedRecord, this, _1, _2),
+                         nullptr);
+}
+
+void
+LedgerImpl::fetchRecordBatch(const Name& peerPrefix, const std::vector<Name>& roots, size_t prefetchLevel)
+{
+  Name batchName = RecordBatch::makeBatchName(peerPrefix, m_config.batchFetchDepth, roots);
+  if (m_pendingBatches.count(batchName) != 0) {
+    return;
+  }
+  std::cout << "[LedgerImpl::fetchRecordBatch] Fetch ancestors of " << roots.size() << " records from " << peerPrefix << std::endl;
+  m_pendingBatches.emplace(batchName, RecordBatch(batchName, RecordBatch::getMaxSegmentCount(m_config.batchMaxRecords)));
+  if (prefetchLevel > 0) {
+    m_prefetchLevels[batchName] = prefetchLevel;
+    m_prefetchRoots.insert(roots.begin(), roots.end());
+  }
+
+  // the first segment tells the number of segments
+  Interest interestForBatch(batchName);
+  interestForBatch.setCanBePrefix(true);
+  interestForBatch.setMustBeFresh(true);
+  // walk-ahead batches go after the batches of records already admitted
+  m_fetchScheduler.fetch(interestForBatch, FetchPriority::ANCESTOR, prefetchLevel,
+                         bind(&LedgerImpl::onFetchedBatchSegment, this, _1, _2),
+                         [this, batchName] (const Interest&) { onBatchFailure(batchName); });
+}
+
+void
+LedgerImpl::onFetchedBatchSegment(const Interest& interest, const Data& data)
+{
+  if (!data.getName().get(-1).isSegment()) {
+    std::cout << "[LedgerImpl::onFetchedBatchSegment] Bad batch segment " << data.getName() << std::endl;
+    return;
+  }
+  Name batchName = data.getName().getPrefix(-1);
+  auto it = m_pendingBatches.find(batchName);
+  if (it == m_pendingBatches.end()) {
+    return;
+  }
+  auto& batch = it->second;
+  bool isFirstSegment = !batch.getFinalSegment();
+  try {
+    batch.addSegment(data);
+  } catch (const std::exception& e) {
+    std::cout << "[LedgerImpl::onFetchedBatchSegment] Bad batch segment because " << e.what() << std::endl;
+    onBatchFailure(batchName);
+    return;
+  }
+
+  if (isFirstSegment && batch.getFinalSegment()) {
+    for (uint64_t segment = 0; segment <= *batch.getFinalSegment(); segment++) {
+      if (segment == data.getName().get(-1).toSegment()) continue;
+      Interest interestForSegment(Name(batchName).appendSegment(segment));
+      interestForSegment.setCanBePrefix(false);
+      interestForSegment.setMustBeFresh(true);
+      m_fetchScheduler.fetch(interestForSegment, FetchPriority::ANCESTOR, 0,
+                             bind(&LedgerImpl::onFetchedBatchSegment, this, _1, _2),
+                             [this, batchName] (const Interest&) { onBatchFailure(batchName); });
+    }
+  }
+
+  if (batch.isComplete()) {
+    RecordBatch completeBatch = std::move(batch);
+    m_pendingBatches.erase(it);
+    onBatchDone(batchName);
+    onFetchedBatch(completeBatch);
+  }
+  else {
+    prefetchAhead(batch);
+  }
+}
+
+void
+LedgerImpl::prefetchAhead(const RecordBatch& batch)
+{
+  if (m_config.prefetchDepth == 0 || m_prefetchedBatches.count(batch.getName()) != 0) {
+    return;
+  }
+  auto levelIt = m_prefetchLevels.find(batch.getName());
+  size_t level = levelIt == m_prefetchLevels.end() ? 0 : levelIt->second;
+  if (level >= m_config.prefetchDepth || m_prefetchLevels.size() >= m_config.prefetchBudget) {
+    return;
+  }
+
+  std::vector<shared_ptr<Data>> leadingRecords;
+  try {
+    leadingRecords = batch.getLeadingRecords();
+  } catch (const std::exception& e) {
+    return;
+  }
+  if (leadingRecords.empty()) {
+    return;
+  }
+  m_prefetchedBatches.insert(batch.getName());
+
+  // the deepest records are first; those pointing to nothing we have are the next roots
+  auto fullNames = RecordBatch::computeFullNames(leadingRecords);
+  std::set<Name> received;
+  std::vector<Name> frontier;
+  for (size_t i = 0; i < leadingRecords.size(); i++) {
+    const Name& fullName = fullNames[i];
+    received.insert(fullName);
+    RecordPointers pointers;
+    try {
+      pointers = Record(leadingRecords[i]).getPointersFromHeader();
+    } catch (const std::exception& e) {
+      continue;
+    }
+    bool noneKnown = !pointers.empty() && std::none_of(pointers.begin(), pointers.end(), [&] (const Name& pointer) {
+      return received.count(pointer) != 0 || m_backend.hasRecord(pointer) || findInSyncStack(pointer) != nullptr;
+    });
+    if (noneKnown && m_prefetchRoots.count(fullName) == 0) {
+      frontier.push_back(fullName);
+      if (frontier.size() == RecordBatch::MAX_ROOTS) break;
+    }
+  }
+  if (!frontier.empty()) {
+    std::cout << "[LedgerImpl::prefetchAhead] Walk ahead of " << frontier.size() << " records" << std::endl;
+    fetchRecordBatch(RecordBatch::getPeerPrefix(batch.getName()), frontier, level + 1);
+  }
+}
+
+void
+LedgerImpl::onBatchDone(const Name& batchName)
+{
+  m_prefetchedBatches.erase(batchName);
+  if (m_prefetchLevels.erase(batchName) != 0) {
+    size_t depth;
+    std::vector<Name> roots;
+    RecordBatch::parseBatchName(batchName, depth, roots);
+    for (const auto& root : roots) {
+      m_prefetchRoots.erase(root);
+    }
+  }
+}
+
+void
+LedgerImpl::onFetchedBatch(const RecordBatch& batch)
+{
+  std::vector<shared_ptr<Data>> records;
+  try {
+    records = batch.getRecords();
+  } catch (const std::exception& e) {
+    std::cout << "[LedgerImpl::onFetchedBatch] Bad batch because " << e.what() << std::endl;
+    onBatchFailure(batch.getName());
+    return;
+  }
+  std::cout << "[LedgerImpl::onFetchedBatch] fetched " << records.size() << " records" << std::endl;
+  // the records failing the cheap checks are not verified
+  auto fullNames = RecordBatch::computeFullNames(records);
+  std::vector<std::pair<shared_ptr<Data>, shared_ptr<const Record>>> decodedRecords;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (isRecordKnown(fullNames[i])) continue;
+    auto record = decodeFetchedRecord(records[i], fullNames[i]);
+    if (record != nullptr) {
+      decodedRecords.emplace_back(records[i], record);
+    }
+  }
+  if (decodedRecords.empty()) {
+    onVerifiedBatch(batch.getName(), {});
+    return;
+  }
+
+  // records come from the deepest to the closest and the verification results come in the
+  // same order, so the preceding records inside the batch are already in the sync stack
+  // when a record is admitted
+  Name batchName = batch.getName();
+  auto remaining = make_shared<size_t>(decodedRecords.size());
+  auto frontier = make_shared<std::vector<Name>>();
+  for (const auto& item : decodedRecords) {
+    auto record = item.second;
+    m_verificationPool.verify(item.first, [this, batchName, record, remaining, frontier] (const VerificationResult& result) {
+      ArenaScope scope(m_packetArena);
+      ArenaVector<const Name*> missingRecords{ArenaAllocator<const Name*>(m_packetArena)};
+      if (admitFetchedRecord(record, result, missingRecords) && !missingRecords.empty()) {
+        frontier->push_back(record->getRecordName());
+      }
+      if (--*remaining == 0) {
+        onVerifiedBatch(batchName, std::move(*frontier));
+      }
+    });
+  }
+}
+
+void
+LedgerImpl::onVerifiedBatch(const Name& batchName, std::vector<Name> frontier)
+{
+  // continue with the records the batch did not resolve, unless a walk-ahead batch is on its way
+  frontier.erase(std::remove_if(frontier.begin(), frontier.end(), [this] (const Name& name) {
+    return m_prefetchRoots.count(name) != 0;
+  }), frontier.end());
+  if (!frontier.empty()) {
+    if (frontier.size() > RecordBatch::MAX_ROOTS) {
+      frontier.resize(RecordBatch::MAX_ROOTS);
+    }
+    fetchRecordBatch(RecordBatch::getPeerPrefix(batchName), frontier);
+  }
+  fetchMissingRecordsOfBatchRoots(batchName);
+  processSyncStack();
+}
+
+void
+LedgerImpl::onBatchFailure(const Name& batchName)
+{
+  m_pendingBatches.erase(batchName);
+  onBatchDone(batchName);
+  fetchMissingRecordsOfBatchRoots(batchName);
+}
+
+void
+LedgerImpl::fetchMissingRecordsOfBatchRoots(const Name& batchName)
+{
+  size_t depth;
+  std::vector<Name> roots;
+  if (!RecordBatch::parseBatchName(batchName, depth, roots)) {
+    return;
+  }
+  for (const auto& root : roots) {
+    const Record* record = findInSyncStack(root);
+    if (record == nullptr) continue;
+    ArenaScope scope(m_packetArena);
+    ArenaVector<const Name*> missingRecords{ArenaAllocator<const Name*>(m_packetArena)};
+    for (const auto& dependency : record->getPointersFromHeader()) {
+      if (!m_backend.hasRecord(dependency) && findInSyncStack(dependency) == nullptr) {
+        missingRecords.push_back(&dependency);
+      }
+    }
+    for (const auto* missingRecord : missingRecords) {
+      fetchRecord(*missingRecord, FetchPriority::ANCESTOR, missingRecords.size());
+    }
+  }
 }
 
 void
 LedgerImpl::onFetchedRecord(const Interest& interest, const Data& data)
 {
   std::cout << "[LedgerImpl::onFetchedRecordForSync] fetched record " << data.getFullName().toUri() << std::endl;
-  if (hasRecord(data.getFullName().toUri())) {
-    std::cout << "- Record already exists in the ledger. Ignore" << std::endl;
+  if (isRecordKnown(data.getFullName())) {
+    return;
+  }
+  auto recordData = make_shared<Data>(data);
+  auto record = decodeFetchedRecord(recordData, data.getFullName());
+  if (record == nullptr) {
     return;
   }
-  if (m_badRecords.count(data.getFullName()) != 0) {
+  m_verificationPool.verify(recordData, [this, record] (const VerificationResult& result) {
+    onVerifiedRecord(record, result);
+  });
+}
+
+shared_ptr<const Record>
+LedgerImpl::decodeFetchedRecord(const shared_ptr<const Data>& data, const Name& fullName)
+{
+  try {
+    auto record = make_shared<const Record>(data, fullName);
+    if (record->getType() == RecordType::GENESIS_RECORD) {
+      throw std::runtime_error("We should not get Genesis record");
+    }
+    if (checkPolicyOfRecord(*record)) {
+      return record;
+    }
+  } catch (const std::exception& e) {
+    std::cout << "- The Data format is not proper for DLedger record because " << e.what() << std::endl;
+  }
+  rememberRejection(fullName);
+  return nullptr;
+}
+
+void
+LedgerImpl::rememberRejection(const Name& recordName)
+{
+  if (recordName.empty() || !recordName.get(-1).isImplicitSha256Digest() ||
+      !m_rejectedDigests.insert(recordName.get(-1)).second) {
+    return;
+  }
+  m_rejectionOrder.push_back(recordName.get(-1));
+  if (m_rejectionOrder.size() > MAX_REJECTED_RECORDS) {
+    m_rejectedDigests.erase(m_rejectionOrder.front());
+    m_rejectionOrder.pop_front();
+  }
+}
+
+bool
+LedgerImpl::isRecentlyRejected(const Name& recordName) const
+{
+  return !recordName.empty() && m_rejectedDigests.count(recordName.get(-1)) != 0;
+}
+
+void
+LedgerImpl::onVerifiedRecord(const shared_ptr<const Record>& record, const VerificationResult& result)
+{
+  ArenaScope scope(m_packetArena);
+  ArenaVector<const Name*> missingRecords{ArenaAllocator<const Name*>(m_packetArena)};
+  if (!admitFetchedRecord(record, result, missingRecords)) {
+    return;
+  }
+  if (!missingRecords.empty()) {
+    std::cout << "- Waiting for record to be added" << std::endl;
+    fetchMissingRecords(*m_syncStack.back().record, missingRecords);
+    return;
+  }
+  processSyncStack();
+}
+
+bool
+LedgerImpl::isRecordKnown(const Name& recordName) const
+{
+  if (m_backend.hasRecord(recordName)) {
+    std::cout << "- Record already exists in the ledger. Ignore" << std::endl;
+    return true;
+  }
+  if (m_badRecords.count(recordName) != 0 || isRecentlyRejected(recordName)) {
       std::cout << "- Known bad record. Ignore" << std::endl;
-      return;
+      return true;
   }
-  for (const auto& stackRecord : m_syncStack) {
-      if (stackRecord.first.getRecordName() == data.getFullName()) {
-          std::cout << "- Record in sync stack already. Ignore" << std::endl;
-          return;
-      }
+  if (findInSyncStack(recordName) != nullptr) {
+      std::cout << "- Record in sync stack already. Ignore" << std::endl;
+      return true;
   }
+  return false;
+}
 
-  try {
-      Record record(data);
-      if (record.getType() == RecordType::GENESIS_RECORD) {
-          throw std::runtime_error("We should not get Genesis record");
-      }
+bool
+LedgerImpl::admitFetchedRecord(const shared_ptr<const Record>& decodedRecord, const VerificationResult& verification,
+                               ArenaVector<const Name*>& missingRecords)
+{
+  const Record& record = *decodedRecord;
+  const Name& recordName = record.getRecordName();
+  // the state may have changed while the record was being verified
+  if (isRecordKnown(recordName)) {
+    return false;
+  }
 
-      if (!checkSyntaxValidityOfRecord(data)) {
+  try {
+      if (!checkSyntaxValidityOfRecord(record, verification.signatureValid)) {
           throw std::runtime_error("Record Syntax error");
       }
 
-      m_syncStack.emplace_back(record, time::system_clock::now());
-      auto precedingRecordNames = record.getPointersFromHeader();
-      bool allPrecedingRecordsInLedger = true;
-      for (const auto &precedingRecordName : precedingRecordNames) {
-          if (m_backend.getRecord(precedingRecordName)) {
+      SyncStackEntry entry{decodedRecord, {}, time::system_clock::now()};
+      if (record.getType() == CERTIFICATE_RECORD) {
+          entry.prevCertificates = CertificateRecord(record).getPrevCertificates();
+      }
+      m_syncStack.push_back(std::move(entry));
+      m_endorsements[recordName] = std::make_pair(verification.endorsed, m_certificateEpoch);
+      for (const auto &precedingRecordName : record.getPointersFromHeader()) {
+          if (m_backend.hasRecord(precedingRecordName)) {
               std::cout << "- Preceding Record " << precedingRecordName << " already in the ledger" << std::endl;
-          } else {
-              allPrecedingRecordsInLedger = false;
-              fetchRecord(precedingRecordName);
+          } else if (findInSyncStack(precedingRecordName) == nullptr) {
+              missingRecords.push_back(&precedingRecordName);
           }
       }
       if (record.getType() == CERTIFICATE_RECORD) {
           std::cout << "- Checking previous cert record" << std::endl;
-          CertificateRecord certRecord(record);
-          for (const auto &prevCertName : certRecord.getPrevCertificates()) {
+          for (const auto &prevCertName : m_syncStack.back().prevCertificates) {
               if (prevCertName.empty()) continue;
-              if (m_backend.getRecord(prevCertName)) {
+              if (m_backend.hasRecord(prevCertName)) {
                   std::cout << "- Preceding Cert Record " << prevCertName << " already in the ledger" << std::endl;
-              } else {
+              } else if (findInSyncStack(prevCertName) == nullptr) {
                   std::cout << "- Preceding Cert Record " << prevCertName << " unseen" << std::endl;
-                  allPrecedingRecordsInLedger = false;
-                  fetchRecord(prevCertName);
+                  missingRecords.push_back(&prevCertName);
               }
           }
       }
-
-      if (!allPrecedingRecordsInLedger) {
-          std::cout << "- Waiting for record to be added" << std::endl;
-          return;
+      if (record.hasSegmentedBody()) {
+          // the body of a record added on its header does not hold back the ancestors
+          fetchRecordBody(record, canAddWithoutBody(record) ? FetchPriority::BACKGROUND : FetchPriority::ANCESTOR);
       }
-
   } catch (const std::exception& e) {
       std::cout << "- The Data format is not proper for DLedger record because " << e.what() << std::endl;
-      std::cout << "--" << data.getFullName() << std::endl;
-      m_badRecords.insert(data.getFullName());
-      return;
+      std::cout << "--" << recordName << std::endl;
+      rememberRejection(recordName);
+      return false;
+  }
+  return true;
+}
+
+void
+LedgerImpl::fetchRecordBody(const Record& record, FetchPriority priority)
+{
+  size_t missingSegments = 0;
+  for (const auto& segmentName : record.getBodySegmentNames()) {
+    if (!m_backend.hasRecord(segmentName)) {
+      fetchBodySegment(segmentName, priority);
+      missingSegments++;
+    }
+  }
+  if (missingSegments == 0) {
+    return;
+  }
+  std::cout << "- Fetch " << missingSegments << " body segments of " << record.getRecordName() << std::endl;
+  m_pendingBodies[record.m_data->getName()] = PendingBody{record.getRecordName(), missingSegments, false, priority, 0};
+}
+
+void
+LedgerImpl::fetchBodySegment(const Name& segmentName, FetchPriority priority)
+{
+  Interest interestForSegment(segmentName);
+  interestForSegment.setCanBePrefix(false);
+  interestForSegment.setMustBeFresh(true);
+  m_fetchScheduler.fetch(interestForSegment, priority, 0,
+                         bind(&LedgerImpl::onFetchedBodySegment, this, _1, _2),
+                         bind(&LedgerImpl::onBodySegmentFailure, this, _1));
+}
+
+void
+LedgerImpl::onBodySegmentFailure(const Interest& interest)
+{
+  // /<record Data name>/<segment>/<implicit digest>
+  Name dataName = interest.getName().getPrefix(-2);
+  auto it = m_pendingBodies.find(dataName);
+  if (it == m_pendingBodies.end()) {
+    return;
+  }
+  time::milliseconds delay = std::min(BODY_RETRY_INTERVAL * (1 << std::min<size_t>(it->second.failures, 6)),
+                                      MAX_BODY_RETRY_INTERVAL);
+  it->second.failures++;
+  std::cout << "- Give up fetching body segment " << interest.getName() << ", retry in " << delay << std::endl;
+  Name segmentName = interest.getName();
+  m_scheduler.schedule(delay, [this, dataName, segmentName] { retryBodySegment(dataName, segmentName); });
+}
+
+void
+LedgerImpl::retryBodySegment(const Name& dataName, const Name& segmentName)
+{
+  auto it = m_pendingBodies.find(dataName);
+  if (it == m_pendingBodies.end() || m_backend.hasRecord(segmentName)) {
+    return;
+  }
+  // a record left the sync stack meanwhile is not added any more, a record in the ledger needs its body
+  if (!m_backend.hasRecord(it->second.recordName) && findInSyncStack(it->second.recordName) == nullptr) {
+    m_pendingBodies.erase(it);
+    return;
+  }
+  fetchBodySegment(segmentName, it->second.priority);
+}
+
+void
+LedgerImpl::onFetchedBodySegment(const Interest& interest, const Data& data)
+{
+  // the Interest carries the implicit digest listed in the signed record header
+  if (m_backend.hasRecord(interest.getName())) {
+    return;
+  }
+  m_backend.putRecord(make_shared<Data>(data));
+  auto it = m_pendingBodies.find(data.getName().getPrefix(-1));
+  if (it != m_pendingBodies.end() && --it->second.missingSegments == 0) {
+    PendingBody body = std::move(it->second);
+    m_pendingBodies.erase(it);
+    std::cout << "[LedgerImpl::onFetchedBodySegment] fetched record body " << data.getName().getPrefix(-1) << std::endl;
+    if (m_backend.hasRecord(body.recordName)) {
+      onRecordBodyAdded(body.recordName, body.isConfirmed);
+    }
+    else {
+      processSyncStack();
+    }
+  }
+}
+
+bool
+LedgerImpl::canAddWithoutBody(const Record& record) const
+{
+  // the certificates are in the body, the certificate manager needs them
+  return m_config.headerFirstSync &&
+         record.getType() != CERTIFICATE_RECORD && record.getType() != REVOCATION_RECORD;
+}
+
+void
+LedgerImpl::onRecordBodyAdded(const Name& recordName, bool isConfirmed)
+{
+  auto record = loadRecord(recordName);
+  if (!record) {
+    std::cout << "- Record body does not match the header of " << recordName << std::endl;
+    return;
+  }
+  referenceBlobs(*record);
+  if (isConfirmed) {
+    onRecordConfirmed(*record);
+  }
+}
+
+bool
+LedgerImpl::hasRecordBody(const Record& record) const
+{
+  for (const auto& segmentName : record.getBodySegmentNames()) {
+    if (!m_backend.hasRecord(segmentName)) {
+      return false;
+    }
   }
+  return true;
+}
 
+void
+LedgerImpl::fetchMissingRecords(const Record& record, const ArenaVector<const Name*>& missingRecords)
+{
+  const auto& pointers = record.getPointersFromHeader();
+  bool nonePrecedingKnown = std::all_of(pointers.begin(), pointers.end(), [&] (const Name& pointer) {
+    return std::any_of(missingRecords.begin(), missingRecords.end(), [&] (const Name* missingRecord) {
+      return *missingRecord == pointer;
+    });
+  });
+  if (m_config.batchFetchDepth > 0 && nonePrecedingKnown) {
+    // likely far behind the producer: fetch the ancestors in batches
+    fetchRecordBatch(record.getProducerPrefix(), {record.getRecordName()});
+    for (const auto* missingRecord : missingRecords) {
+      if (std::find(pointers.begin(), pointers.end(), *missingRecord) == pointers.end()) {
+        fetchRecord(*missingRecord, FetchPriority::ANCESTOR, missingRecords.size());
+      }
+    }
+    return;
+  }
+  // the records closest to being added go first
+  for (const auto* missingRecord : missingRecords) {
+    fetchRecord(*missingRecord, FetchPriority::ANCESTOR, missingRecords.size());
+  }
+}
+
+const Record*
+LedgerImpl::findInSyncStack(const Name& recordName) const
+{
+  for (const auto& entry : m_syncStack) {
+    if (entry.record->getRecordName() == recordName) {
+      return entry.record.get();
+    }
+  }
+  return nullptr;
+}
+
+void
+LedgerImpl::processSyncStack()
+{
   int stackSize = INT_MAX;
   while (stackSize != m_syncStack.size()) {
       stackSize = m_syncStack.size();
       std::cout << "- SyncStack size " << m_syncStack.size() << std::endl;
       for (auto it = m_syncStack.begin(); it != m_syncStack.end();) {
-          if (checkRecordAncestor(it->first)) {
+          if (checkRecordAncestor(*it)) {
               it = m_syncStack.erase(it);
-          } else if(time::abs(time::system_clock::now() - it->second) > m_config.ancestorFetchTimeout){
-              std::cout << "-- Timeout on fetching ancestor for " << it->first.getRecordName().toUri() << std::endl;
+          } else if(time::abs(time::system_clock::now() - it->arrivalTime) > m_config.ancestorFetchTimeout){
+              std::cout << "-- Timeout on fetching ancestor for " << it->record->getRecordName().toUri() << std::endl;
+              m_endorsements.erase(it->record->getRecordName());
+              m_pendingBodies.erase(it->record->m_data->getName());
               it = m_syncStack.erase(it);
           } else {
               // else, some preceding records are not yet fetched
@@ -529,44 +1508,63 @@ LedgerImpl::onFetchedRecord(const Interest& interest, const Data& data)
   }
 }
 
-bool LedgerImpl::checkRecordAncestor(const Record &record) {
+bool LedgerImpl::checkRecordAncestor(const SyncStackEntry& entry) {
+    const Record& record = *entry.record;
     bool readyToAdd = true;
     bool badRecord = false;
     for (const auto& precedingRecordName : record.getPointersFromHeader()) {
-        if (m_badRecords.count(precedingRecordName) != 0) {
+        if (m_badRecords.count(precedingRecordName) != 0 || isRecentlyRejected(precedingRecordName)) {
             // has preceding record being bad record
             badRecord = true;
             readyToAdd = false;
             break;
         }
-        if (!hasRecord(precedingRecordName.toUri())) {
+        if (!m_backend.hasRecord(precedingRecordName)) {
             readyToAdd = false;
             break;
         }
     }
-    if (record.getType() == CERTIFICATE_RECORD) {
-        CertificateRecord certRecord(record);
-        for (const auto &prevCertName : certRecord.getPrevCertificates()) {
-            if (!prevCertName.empty() && !m_backend.getRecord(prevCertName)) {
-                readyToAdd = false;
-            }
+    for (const auto &prevCertName : entry.prevCertificates) {
+        if (!prevCertName.empty() && !m_backend.hasRecord(prevCertName)) {
+            readyToAdd = false;
+        }
+    }
+    if (readyToAdd && record.hasSegmentedBody() && !canAddWithoutBody(record) && !hasRecordBody(record)) {
+        readyToAdd = false;
+    }
+    shared_ptr<const Record> recordToAdd = entry.record;
+    if (!badRecord && readyToAdd && record.hasSegmentedBody() &&
+        (record.getType() == CERTIFICATE_RECORD || record.getType() == REVOCATION_RECORD)) {
+        // the format was checked on the header only, the certificates are in the body
+        auto fullRecord = make_shared<Record>(record);
+        if (!loadRecordBody(*fullRecord) || !m_config.certificateManager->verifyRecordFormat(*fullRecord)) {
+            std::cout << "-- bad certificate/revocation record body" << std::endl;
+            badRecord = true;
+            readyToAdd = false;
+        } else {
+            // kept with its body, so the certificates are parsed only once
+            recordToAdd = fullRecord;
         }
     }
     if (!badRecord && readyToAdd) {
         std::cout << "- Good record. Will add record in to the ledger" << std::endl;
-        addToTailingRecord(record, checkEndorseValidityOfRecord(*(record.m_data)));
+        addToTailingRecord(recordToAdd, checkEndorseValidityOfRecord(record));
         return true;
     }
     if (badRecord) {
         std::cout << "- Bad record. Will remove it and all its later records" << std::endl;
         m_badRecords.insert(record.getRecordName());
+        m_endorsements.erase(record.getRecordName());
+        m_pendingBodies.erase(record.m_data->getName());
         return true;
     }
     return false;
 }
 
 void
-LedgerImpl::addToTailingRecord(const Record& record, bool verified) {
+LedgerImpl::addToTailingRecord(const shared_ptr<const Record>& recordPtr, bool verified) {
+    ArenaScope scope(m_packetArena);
+    const Record& record = *recordPtr;
     if (m_tailRecords.count(record.getRecordName()) != 0) {
         std::cout << "[LedgerImpl::addToTailingRecord] Repeated add record: " << record.getRecordName()
                   << std::endl;
@@ -586,30 +1584,33 @@ LedgerImpl::addToTailingRecord(const Record& record, bool verified) {
     }
 
     //add record to tailing record
-    m_tailRecords[record.getRecordName()] = TailingRecordState{refVerified, std::set<Name>(), verified};
-    m_backend.putRecord(record.m_data);
+    m_tailRecords[record.getRecordName()] = TailingRecordState{refVerified, std::set<Name>(), verified, recordPtr};
+    m_backend.putRecord(record.getRecordName(), record.m_data);
+    referenceBlobs(record);
 
     //update weight of the system
-    std::stack<Name> stack;
-    std::set<Name> updatedRecords;
+    //the walk keeps the names of the tailing record map, not copies
+    std::stack<const Name*, ArenaVector<const Name*>> stack{ArenaVector<const Name*>(ArenaAllocator<const Name*>(m_packetArena))};
+    ArenaSet<const Name*, NamePointerLess> updatedRecords{NamePointerLess(), ArenaAllocator<const Name*>(m_packetArena)};
 
     //only count the weight if the record is valid for all policies
+    //the records pushed are all in the tailing record map, walk their decoded records
+    const Name& producerPrefix = record.getProducerPrefix();
     if (verified) {
-        stack.push(record.getRecordName());
+        stack.push(&m_tailRecords.find(record.getRecordName())->first);
     }
     while (!stack.empty()) {
-        RecordName currentRecordName(stack.top());
+        const Record& currentRecord = *m_tailRecords.at(*stack.top()).record;
         stack.pop();
-        if (currentRecordName.getRecordType() == GENESIS_RECORD) continue;
-        Record currentRecord(m_backend.getRecord(currentRecordName));
-        auto precedingRecordList = currentRecord.getPointersFromHeader();
-        for (const auto &precedingRecord : precedingRecordList) {
-            if (RecordName(precedingRecord).getProducerPrefix() == record.getProducerPrefix()) continue;
-            if (m_tailRecords.count(precedingRecord) != 0 &&
-                m_tailRecords[precedingRecord].refSet.insert(record.getProducerPrefix()).second) {
-                stack.push(precedingRecord);
-                updatedRecords.insert(precedingRecord);
-                std::cout << record.getProducerPrefix() << " confirms " << precedingRecord.toUri() << std::endl;
+        if (currentRecord.getType() == GENESIS_RECORD) continue;
+        for (const auto &precedingRecord : currentRecord.getPointersFromHeader()) {
+            auto preceding = m_tailRecords.find(precedingRecord);
+            if (preceding == m_tailRecords.end() ||
+                preceding->second.record->getProducerPrefix() == producerPrefix) continue;
+            if (preceding->second.refSet.insert(producerPrefix).second) {
+                stack.push(&preceding->first);
+                updatedRecords.insert(&preceding->first);
+                std::cout << producerPrefix << " confirms " << precedingRecord.toUri() << std::endl;
             }
         }
     }
@@ -617,18 +1618,35 @@ LedgerImpl::addToTailingRecord(const Record& record, bool verified) {
     //remove deep records
     int removeWeight = max(m_config.contributionWeight + 1, m_config.confirmWeight);
     bool referenceNeedUpdate = false;
-    for (const auto & updatedRecord : updatedRecords) {
-        auto& tailingState = m_tailRecords[updatedRecord];
+    // the records are confirmed once the map is updated, the application may add records meanwhile
+    ArenaVector<shared_ptr<const Record>> confirmedRecords{ArenaAllocator<shared_ptr<const Record>>(m_packetArena)};
+    for (const Name* updatedRecord : updatedRecords) {
+        auto tailingRecord = m_tailRecords.find(*updatedRecord);
+        auto& tailingState = tailingRecord->second;
         if (tailingState.refSet.size() == m_config.confirmWeight) {
-            std::cout << "confirmed " << updatedRecord.toUri() << std::endl;
+            std::cout << "confirmed " << updatedRecord->toUri() << std::endl;
             if (!tailingState.referenceVerified) {
                 tailingState.referenceVerified = true;
                 referenceNeedUpdate = true;
             }
-            onRecordConfirmed(m_backend.getRecord(updatedRecord));
+            // a segmented body is loaded already for certificate and revocation records
+            if (!tailingState.record->hasSegmentedBody() || !tailingState.record->getRecordItems().empty()) {
+                confirmedRecords.push_back(tailingState.record);
+            } else {
+                // the application gets the record with its body, once it is fetched
+                auto confirmedRecord = loadRecord(*updatedRecord);
+                if (confirmedRecord) {
+                    confirmedRecords.push_back(make_shared<const Record>(std::move(*confirmedRecord)));
+                } else {
+                    auto pendingBody = m_pendingBodies.find(tailingState.record->m_data->getName());
+                    if (pendingBody != m_pendingBodies.end()) {
+                        pendingBody->second.isConfirmed = true;
+                    }
+                }
+            }
         }
         if (tailingState.refSet.size() >= removeWeight) {
-            m_tailRecords.erase(updatedRecord);
+            m_tailRecords.erase(tailingRecord);
         }
     }
 
@@ -638,8 +1656,7 @@ LedgerImpl::addToTailingRecord(const Record& record, bool verified) {
         for (auto &r : m_tailRecords) {
             if (!r.second.referenceVerified && r.second.endorseVerified) {
                 bool referenceVerified = true;
-                Record currentRecord(m_backend.getRecord(r.first));
-                for (const auto &precedingRecord : currentRecord.getPointersFromHeader()) {
+                for (const auto &precedingRecord : r.second.record->getPointersFromHeader()) {
                     if ((m_tailRecords.count(precedingRecord) &&
                             m_tailRecords[precedingRecord].refSet.size() < m_config.confirmWeight) &&
                         !m_tailRecords[precedingRecord].referenceVerified) {
@@ -655,9 +1672,31 @@ LedgerImpl::addToTailingRecord(const Record& record, bool verified) {
         }
     }
 
+    for (const auto& confirmedRecord : confirmedRecords) {
+        onRecordConfirmed(*confirmedRecord);
+    }
+
     dumpList(m_tailRecords);
 }
 
+const security::SigningInfo&
+LedgerImpl::getSigningInfo()
+{
+  if (!m_signingInfo) {
+    // resolving the identity goes through the PIB, do it only once
+    auto key = m_keychain.getPib().getIdentity(m_config.peerPrefix).getDefaultKey();
+    m_signingInfo = security::signingByKey(key);
+  }
+  return *m_signingInfo;
+}
+
+void
+LedgerImpl::resetSigningInfo()
+{
+  m_signingInfo = nullopt;
+  m_syncInterest = nullptr;
+}
+
 void LedgerImpl::onRecordConfirmed(const Record &record){
     std::cout << "- [LedgerImpl::onRecordConfirmed] accept record" << std::endl;
 
@@ -672,14 +1711,34 @@ void LedgerImpl::onRecordConfirmed(const Record &record){
             for (const auto &c : certRecord.getPrevCertificates()) {
                 m_lastCertRecords.remove(c);
             }
+            for (const auto &cert : certRecord.getCertificates()) {
+                if (cert.getIdentity() == m_config.peerPrefix) {
+                    std::cout << "-- New certificate for us, reload the signing key" << std::endl;
+                    resetSigningInfo();
+                }
+            }
         } catch (const std::exception &e) {
             std::cout << "-- Bad certificate record format. " << std::endl;
             return;
         }
     }
+    else if (record.getType() == RecordType::REVOCATION_RECORD) {
+        try {
+            for (const auto &certName : RevocationRecord(record).getRevokedCertificates()) {
+                if (m_config.peerPrefix.isPrefixOf(certName)) {
+                    resetSigningInfo();
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cout << "-- Bad revocation record format. " << std::endl;
+            return;
+        }
+    }
 
     if (record.getType() == RecordType::CERTIFICATE_RECORD || record.getType() == RecordType::REVOCATION_RECORD) {
+        std::unique_lock<std::shared_timed_mutex> lock(m_certificateMutex);
         m_config.certificateManager->acceptRecord(record);
+        m_certificateEpoch++;
     }
 
     if (m_onRecordAppConfirmed != nullptr) {
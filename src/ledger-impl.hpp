@@ -4,7 +4,11 @@
 #include "dledger/ledger.hpp"
 #include "dledger/record.hpp"
 #include "dledger/config.hpp"
+#include "arena.hpp"
 #include "backend.hpp"
+#include "record-batch.hpp"
+#include "fetch-scheduler.hpp"
+#include "verification-pool.hpp"
 #include <ndn-cxx/security/certificate.hpp>
 #include <ndn-cxx/security/key-chain.hpp>
 #include <ndn-cxx/face.hpp>
@@ -12,6 +16,8 @@
 #include <boost/asio/io_service.hpp>
 #include <ndn-cxx/util/io.hpp>
 #include <ndn-cxx/util/scheduler.hpp>
+#include <deque>
+#include <shared_mutex>
 #include <stack>
 #include <random>
 
@@ -29,9 +35,24 @@ public:
   ReturnCode
   createRecord(Record& record) override;
 
+  ReturnCode
+  createRecord(Record&& record) override;
+
+  void
+  submitRecordItem(const Block& item, const OnRecordItemSubmitted& onSubmitted) override;
+
+  BlobReference
+  putBlob(const uint8_t* content, size_t size) override;
+
+  ConstBufferPtr
+  getBlob(const BlobReference& reference) const override;
+
   optional<Record>
   getRecord(const std::string& recordName) const override;
 
+  shared_ptr<const Record>
+  getSharedRecord(const std::string& recordName) const override;
+
   bool
   hasRecord(const std::string& recordName) const override;
 
@@ -39,6 +60,33 @@ public:
   listRecord(const std::string& prefix) const override;
 
 private:
+  /**
+   * Append a new record to the ledger, without announcing it.
+   * @p isMovable, input, whether the record can be moved into the ledger rather than copied
+   * @return the full name of the record on success
+   */
+  ReturnCode
+  appendNewRecord(Record& record, bool isMovable);
+
+  /**
+   * Send a SYNC Interest for a record just appended.
+   * @p appended, input, the result of appendNewRecord, returned as it is if the record is not appended
+   */
+  ReturnCode
+  announceNewRecord(ReturnCode appended);
+
+  /**
+   * Schedule the next record of the submission queue at the next production slot.
+   */
+  void
+  scheduleSubmissions();
+
+  /**
+   * Create a record with the submitted items at the head of the queue, as many as fit into the record packet.
+   */
+  void
+  produceSubmittedRecord();
+
   void
   onNack(const Interest&, const lp::Nack& nack);
 
@@ -50,10 +98,27 @@ private:
   ReturnCode
   sendSyncInterest();
 
+  /**
+   * The checks of a record which need no signature verification, cheapest first:
+   * format, timestamp, rate limit and InterLock policy.
+   * It does not change the ledger state, so it runs before the signature is verified.
+   */
+  bool
+  checkPolicyOfRecord(const Record& record) const;
+
+  /**
+   * @param signatureValid the result of CertificateManager::verifySignature on the record
+   */
   bool
-  checkSyntaxValidityOfRecord(const Data& data);
+  checkSyntaxValidityOfRecord(const Record& record, bool signatureValid);
   bool
-  checkEndorseValidityOfRecord(const Data& data);
+  checkEndorseValidityOfRecord(const Record& record);
+
+  /**
+   * Run the signature checks of a batch of records, called on the verification threads.
+   */
+  std::vector<VerificationResult>
+  verifyRecordSignatures(const std::vector<shared_ptr<const Data>>& records) const;
 
   // Interest format: each <> is only one name component
   // /<multicast_prefix>/NOTIF/<Full Name of Record>
@@ -73,58 +138,317 @@ private:
   onRecordRequest(const Interest& interest);
 
   // Zhiyi's temp function
+  /**
+   * Fetch a record through the fetch scheduler.
+   * Certificate records are always fetched with the certificate priority.
+   * @param rank the order inside the priority class, e.g., the number of missing
+   *             preceding records of the record waiting for this one
+   */
   void
-  fetchRecord(const Name& dataName);
+  fetchRecord(const Name& dataName, FetchPriority priority = FetchPriority::ANCESTOR, size_t rank = 0);
   void
   onFetchedRecord(const Interest& interest, const Data& data);
 
+  /**
+   * Decode a fetched record and run the checks which need no signature verification.
+   * @param fullName the full name of the record, computed in a batch for the records of a batch
+   * @return nullptr if the record is rejected
+   */
+  shared_ptr<const Record>
+  decodeFetchedRecord(const shared_ptr<const Data>& data, const Name& fullName);
+
+  void
+  onVerifiedRecord(const shared_ptr<const Record>& record, const VerificationResult& result);
+
+  /**
+   * Remember a record rejected before it is added to the sync stack, by its implicit digest.
+   * Only the latest rejections are kept, so a flood of bad records cannot grow the memory.
+   */
+  void
+  rememberRejection(const Name& recordName);
+
+  bool
+  isRecentlyRejected(const Name& recordName) const;
+
+  /**
+   * @return true if an item of a SYNC Interest needs nothing from us: a certificate record
+   *         we have, a record we are tailing, or a record being fetched, validated or rejected
+   */
+  bool
+  isSyncItemKnown(const Block& item) const;
+
+  /**
+   * @return true if the record is in the ledger, in the sync stack, known to be bad or recently rejected
+   */
+  bool
+  isRecordKnown(const Name& recordName) const;
+
+  /**
+   * Check a fetched record and put it into the sync stack.
+   * @param record the record decoded by decodeFetchedRecord, which goes through the later checks
+   * @param missingRecords output, the preceding records of the record which are neither in the ledger
+   *                       nor in the sync stack
+   * @return true if the record is added to the sync stack
+   */
+  bool
+  admitFetchedRecord(const shared_ptr<const Record>& record, const VerificationResult& verification,
+                     ArenaVector<const Name*>& missingRecords);
+
+  /**
+   * Fetch the missing preceding records of a record in the sync stack,
+   * in one batch if none of its preceding records is known.
+   */
+  void
+  fetchMissingRecords(const Record& record, const ArenaVector<const Name*>& missingRecords);
+
+  /**
+   * Add the records in the sync stack whose ancestors are all resolved.
+   */
+  void
+  processSyncStack();
+
+  const Record*
+  findInSyncStack(const Name& recordName) const;
+
+  // Item Interest format: see ItemProof
+  void
+  onItemRequest(const Interest& interest);
+
+  // Blob Interest format: see BlobReference
+  void
+  onBlobRequest(const Interest& interest);
+
+  /**
+   * Count the references of a stored record to blobs and fetch the blobs not in the store.
+   */
+  void
+  referenceBlobs(const Record& record);
+
+  /**
+   * Fetch the segments of a blob from the peer, unless the blob is stored or being fetched already.
+   */
+  void
+  fetchBlob(const BlobReference& reference, const Name& peerPrefix);
+
+  void
+  onFetchedBlobSegment(const Interest& interest, const Data& data);
+
+  // Batch Interest format: see RecordBatch
+  void
+  onBatchRequest(const Interest& interest);
+
+  /**
+   * @param prefetchLevel the number of batches this one is requested ahead of validation,
+   *                      0 for a batch requested for records already admitted
+   */
+  void
+  fetchRecordBatch(const Name& peerPrefix, const std::vector<Name>& roots, size_t prefetchLevel = 0);
+
+  /**
+   * Request the ancestors of the deepest records received so far in a batch,
+   * without waiting for the batch to complete and be validated.
+   */
+  void
+  prefetchAhead(const RecordBatch& batch);
+
+  void
+  onBatchDone(const Name& batchName);
+
+  void
+  onFetchedBatchSegment(const Interest& interest, const Data& data);
+
+  void
+  onFetchedBatch(const RecordBatch& batch);
+
+  /**
+   * Continue with the records a batch did not resolve once all its records are verified.
+   * @param frontier the records of the batch whose preceding records are still missing
+   */
+  void
+  onVerifiedBatch(const Name& batchName, std::vector<Name> frontier);
+
+  void
+  onBatchFailure(const Name& batchName);
+
+  /**
+   * Fetch the body segments of a record which are not in the backend yet.
+   */
+  void
+  fetchRecordBody(const Record& record, FetchPriority priority);
+
+  void
+  fetchBodySegment(const Name& segmentName, FetchPriority priority);
+
+  void
+  onFetchedBodySegment(const Interest& interest, const Data& data);
+
+  /**
+   * Fetch a body segment again after a backoff, as long as its record is in the ledger or the sync stack.
+   */
+  void
+  onBodySegmentFailure(const Interest& interest);
+
+  void
+  retryBodySegment(const Name& dataName, const Name& segmentName);
+
+  bool
+  hasRecordBody(const Record& record) const;
+
+  /**
+   * Whether a record with a segmented body can be added to the ledger before its body is fetched.
+   */
+  bool
+  canAddWithoutBody(const Record& record) const;
+
+  /**
+   * Handle the body of a record added to the ledger on its header: reference its blobs
+   * and deliver it to the application if it has been confirmed meanwhile.
+   */
+  void
+  onRecordBodyAdded(const Name& recordName, bool isConfirmed);
+
+  /**
+   * Read a record from the backend, including its segmented body.
+   * @return nullopt if the record or one of its body segments is not in the backend
+   */
+  optional<Record>
+  loadRecord(const Name& recordName) const;
+
+  /**
+   * Decode the segmented body of a record from the segments in the backend.
+   * @return false if a segment is not in the backend or does not match the header
+   */
+  bool
+  loadRecordBody(Record& record) const;
+
+  /**
+   * Fetch the preceding records of the batch roots which are still missing one by one.
+   */
+  void
+  fetchMissingRecordsOfBatchRoots(const Name& batchName);
+
   /**
    * Adds the record to backend and the tailing record map
    * @param record
    */
   void
-  addToTailingRecord(const Record& record, bool verified);
+  addToTailingRecord(const shared_ptr<const Record>& record, bool verified);
 
   //Siqi's temp function
   struct TailingRecordState{
       bool referenceVerified;
       std::set<Name> refSet;
       bool endorseVerified;
+      shared_ptr<const Record> record; // the decoded record, without its segmented body
   };
   static void dumpList(const std::map<Name, TailingRecordState>& weight);
 
+  /**
+   * A record waiting in the sync stack for its preceding records.
+   */
+  struct SyncStackEntry
+  {
+    shared_ptr<const Record> record;
+    std::vector<Name> prevCertificates; // of a certificate record
+    time::system_clock::TimePoint arrivalTime;
+  };
+
   /**
    * Check if the ancestor of the record is OK
-   * @param record the record to be checked
+   * @param entry the record to be checked
    * @return true if the record is resolved; it is added or set as bad Record
    */
-  bool checkRecordAncestor(const Record &record);
+  bool checkRecordAncestor(const SyncStackEntry& entry);
 
   /**
    * handles the information when a record is accepted.
    */
   void onRecordConfirmed(const Record &record);
 
+  /**
+   * Get the signing info of the default key of the peer identity.
+   * The key is resolved through the PIB once and kept until our certificates change.
+   * May throw exception if the identity or its key is not in the KeyChain
+   */
+  const security::SigningInfo&
+  getSigningInfo();
+
+  /**
+   * Drop the cached signing key and the signed SYNC Interest.
+   */
+  void
+  resetSigningInfo();
+
 private:
   Config m_config;
   Face& m_network;
   Scheduler m_scheduler;
   Backend m_backend;
+  FetchScheduler m_fetchScheduler;
   security::KeyChain& m_keychain;
 
   std::map<Name, TailingRecordState> m_tailRecords;
 
   std::map<Name, time::system_clock::TimePoint> m_rateCheck; // producer to time
+  time::steady_clock::TimePoint m_lastRecordCreation; // of our own records
+
+  struct Submission
+  {
+    Block item;
+    OnRecordItemSubmitted onSubmitted;
+  };
+  std::deque<Submission> m_submissions;
+  scheduler::EventId m_submissionEventID;
 
   // Zhiyi's temp member variable
-  std::list<std::pair<Record, time::system_clock::TimePoint>> m_syncStack;
+  std::list<SyncStackEntry> m_syncStack;
+  Arena m_packetArena; // temporaries of validating and propagating one record
 
   // Siqi's temp member variable
   std::set<Name> m_badRecords;
+  std::set<name::Component> m_rejectedDigests; // records rejected before entering the sync stack
+  std::deque<name::Component> m_rejectionOrder; // the oldest rejection first
   scheduler::EventId m_syncEventID;
   scheduler::EventId m_replySyncEventID;
   std::mt19937_64 m_randomEngine{std::random_device{}()};
   std::list<Name> m_lastCertRecords; // for certificate chains
+
+  std::map<Name, RecordBatch> m_pendingBatches; // batches being fetched
+  std::map<Name, std::vector<shared_ptr<Data>>> m_batchSegments; // batches being served
+  size_t m_batchSegmentsSize = 0; // the encoded size of the batches being served
+  std::map<Name, size_t> m_prefetchLevels; // walk-ahead batch to its level
+  std::set<Name> m_prefetchedBatches; // batches whose walk-ahead batch has been requested
+  std::set<Name> m_prefetchRoots; // roots of walk-ahead batches in flight
+
+  struct PendingBody
+  {
+    Name recordName; // full name
+    size_t missingSegments;
+    bool isConfirmed; // confirmed on its header, waiting for the body to be delivered
+    FetchPriority priority;
+    size_t failures; // give-ups of the fetch scheduler, for the backoff
+  };
+  std::map<Name, PendingBody> m_pendingBodies; // record Data name to its missing body
+
+  struct PendingBlob
+  {
+    BlobReference reference;
+    std::vector<Block> segments; // the contents received so far, by segment
+    size_t missingSegments;
+  };
+  std::map<Name, PendingBlob> m_pendingBlobs; // blob name without segment
+
+  optional<security::SigningInfo> m_signingInfo;
+  shared_ptr<Interest> m_syncInterest; // the last signed SYNC Interest
+  Block m_syncAppParam; // the tailing records carried by m_syncInterest
+
+  // verification threads read the certificate manager, the io thread updates it
+  mutable std::shared_timed_mutex m_certificateMutex;
+  uint64_t m_certificateEpoch = 0; // incremented when a certificate or revocation record is accepted
+  std::map<Name, std::pair<bool, uint64_t>> m_endorsements; // record in sync stack to endorsement and epoch
+
+  // the last member, so the threads are stopped first
+  VerificationPool m_verificationPool;
 };
 
 // class Ledger
@@ -0,0 +1,287 @@
+#include "record-batch.hpp"
+#include "record_name.hpp"
+#include "sha256-batch.hpp"
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/encoding/buffer.hpp>
+
+namespace dledger {
+
+static const std::string ANCESTORS_COMPONENT = "ANCESTORS";
+
+const size_t RecordBatch::MAX_SEGMENT_SIZE;
+const size_t RecordBatch::MAX_ROOTS;
+
+RecordBatch::RecordBatch(const Name& batchName, size_t maxSegments)
+    : m_name(batchName)
+    , m_maxSegments(maxSegments)
+{
+}
+
+bool
+RecordBatch::addSegment(const Data& segment)
+{
+  if (!segment.getName().get(-1).isSegment()) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("batch segment without segment number"));
+  }
+  uint64_t segmentNo = segment.getName().get(-1).toSegment();
+  if (segmentNo >= m_maxSegments) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("batch segment number out of bound"));
+  }
+  if (segment.getFinalBlock()) {
+    uint64_t finalSegment = segment.getFinalBlock()->toSegment();
+    if (finalSegment >= m_maxSegments || finalSegment < segmentNo) {
+      BOOST_THROW_EXCEPTION(std::runtime_error("batch final segment number out of bound"));
+    }
+    m_finalSegment = finalSegment;
+  }
+  return m_segments.emplace(segmentNo, segment.getContent()).second;
+}
+
+bool
+RecordBatch::isComplete() const
+{
+  return m_finalSegment && m_segments.size() == *m_finalSegment + 1;
+}
+
+std::vector<shared_ptr<Data>>
+RecordBatch::getRecords() const
+{
+  return decodeRecords(true);
+}
+
+std::vector<shared_ptr<Data>>
+RecordBatch::getLeadingRecords() const
+{
+  return decodeRecords(false);
+}
+
+std::vector<shared_ptr<Data>>
+RecordBatch::decodeRecords(bool isComplete) const
+{
+  // segments without gaps from the first one
+  std::vector<const Block*> contents;
+  size_t totalSize = 0;
+  for (const auto& segment : m_segments) {
+    if (segment.first != contents.size()) break;
+    contents.push_back(&segment.second);
+    totalSize += segment.second.value_size();
+  }
+  auto buffer = make_shared<Buffer>();
+  buffer->reserve(totalSize);
+  for (const auto* content : contents) {
+    buffer->insert(buffer->end(), content->value_begin(), content->value_end());
+  }
+
+  std::vector<shared_ptr<Data>> records;
+  size_t offset = 0;
+  while (offset < buffer->size()) {
+    bool isOk;
+    Block block;
+    std::tie(isOk, block) = Block::fromBuffer(buffer, offset);
+    if (!isOk && !isComplete) {
+      // the rest of the record is in a segment not received yet
+      break;
+    }
+    if (!isOk || block.type() != tlv::Data) {
+      BOOST_THROW_EXCEPTION(std::runtime_error("bad record in batch"));
+    }
+    offset += block.size();
+    records.push_back(make_shared<Data>(block));
+  }
+  return records;
+}
+
+Name
+RecordBatch::makeBatchName(const Name& peerPrefix, size_t depth, const std::vector<Name>& roots)
+{
+  Name batchName = peerPrefix;
+  batchName.append(ANCESTORS_COMPONENT).appendNumber(depth);
+  for (const auto& root : roots) {
+    batchName.append(name::Component(root.wireEncode()));
+  }
+  return batchName;
+}
+
+size_t
+RecordBatch::getMaxSegmentCount(size_t maxRecords)
+{
+  return maxRecords * MAX_NDN_PACKET_SIZE / MAX_SEGMENT_SIZE + 1;
+}
+
+bool
+RecordBatch::isBatchName(const Name& name)
+{
+  return findAncestorsComponent(name) != nullopt;
+}
+
+bool
+RecordBatch::parseBatchName(const Name& name, size_t& depth, std::vector<Name>& roots)
+{
+  auto position = findAncestorsComponent(name);
+  if (!position) {
+    return false;
+  }
+  depth = name.get(*position + 1).toNumber();
+  roots.clear();
+  for (size_t i = *position + 2; i < name.size() && !name.get(i).isSegment(); i++) {
+    roots.emplace_back();
+    decodeRoot(name.get(i), roots.back());
+  }
+  return true;
+}
+
+Name
+RecordBatch::getPeerPrefix(const Name& batchName)
+{
+  auto position = findAncestorsComponent(batchName);
+  return position ? batchName.getPrefix(*position) : batchName;
+}
+
+optional<size_t>
+RecordBatch::findAncestorsComponent(const Name& name)
+{
+  // the peer prefix may have any length and components, so the name is read from its end
+  size_t end = name.size();
+  if (end > 0 && name.get(-1).isSegment()) {
+    end--;
+  }
+  size_t rootCount = 0;
+  Name root;
+  while (end > 0 && rootCount < MAX_ROOTS && decodeRoot(name.get(end - 1), root)) {
+    end--;
+    rootCount++;
+  }
+  if (rootCount == 0 || end < 2 || !name.get(end - 1).isNumber()) {
+    return nullopt;
+  }
+  const auto& ancestors = name.get(end - 2);
+  if (!ancestors.isGeneric() || ancestors.value_size() != ANCESTORS_COMPONENT.size() ||
+      !std::equal(ANCESTORS_COMPONENT.begin(), ANCESTORS_COMPONENT.end(), ancestors.value_begin())) {
+    return nullopt;
+  }
+  return end - 2;
+}
+
+bool
+RecordBatch::decodeRoot(const name::Component& component, Name& root)
+{
+  // checked first, as most components are not encoded names
+  if (!component.isGeneric() || component.value_size() < 2 || component.value()[0] != tlv::Name) {
+    return false;
+  }
+  try {
+    Block wire(component.value(), component.value_size());
+    if (wire.size() != component.value_size()) {
+      return false;
+    }
+    root.wireDecode(wire);
+  }
+  catch (const std::exception& e) {
+    return false;
+  }
+  return true;
+}
+
+std::vector<shared_ptr<Data>>
+RecordBatch::collectAncestors(const Backend& backend, const std::vector<Name>& roots, size_t depth, size_t maxRecords)
+{
+  std::vector<shared_ptr<Data>> ancestors;
+  std::set<Name> visited(roots.begin(), roots.end());
+  std::vector<shared_ptr<Data>> level;
+  for (const auto& root : roots) {
+    auto data = backend.getRecord(root);
+    if (data != nullptr) level.push_back(data);
+  }
+
+  for (size_t currentDepth = 0; currentDepth < depth && !level.empty(); currentDepth++) {
+    std::vector<shared_ptr<Data>> nextLevel;
+    for (const auto& data : level) {
+      std::vector<Name> dependencies;
+      try {
+        Record record(data);
+        const auto& pointers = record.getPointersFromHeader();
+        dependencies.assign(pointers.begin(), pointers.end());
+        if (record.getType() == CERTIFICATE_RECORD) {
+          for (const auto& prevCertName : CertificateRecord(record).getPrevCertificates()) {
+            if (!prevCertName.empty()) dependencies.push_back(prevCertName);
+          }
+        }
+      } catch (const std::exception& e) {
+        continue;
+      }
+
+      for (const auto& dependency : dependencies) {
+        if (!visited.insert(dependency).second) continue;
+        try {
+          if (RecordName::parse(dependency).recordType == GENESIS_RECORD) continue;
+        } catch (const std::exception& e) {
+          continue;
+        }
+        auto ancestor = backend.getRecord(dependency);
+        if (ancestor == nullptr) continue;
+        ancestors.push_back(ancestor);
+        nextLevel.push_back(ancestor);
+        if (ancestors.size() >= maxRecords) {
+          std::reverse(ancestors.begin(), ancestors.end());
+          return ancestors;
+        }
+      }
+    }
+    level = std::move(nextLevel);
+  }
+  std::reverse(ancestors.begin(), ancestors.end());
+  return ancestors;
+}
+
+std::vector<Name>
+RecordBatch::computeFullNames(const std::vector<shared_ptr<Data>>& records)
+{
+  std::vector<DigestInput> inputs;
+  inputs.reserve(records.size());
+  for (const auto& record : records) {
+    const Block& wire = record->wireEncode();
+    inputs.push_back(DigestInput{wire.wire(), wire.size()});
+  }
+  auto digests = computeSha256Batch(inputs);
+
+  std::vector<Name> fullNames;
+  fullNames.reserve(records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    fullNames.push_back(records[i]->getName());
+    fullNames.back().appendImplicitSha256Digest(digests[i].data(), digests[i].size());
+  }
+  return fullNames;
+}
+
+std::vector<shared_ptr<Data>>
+RecordBatch::makeSegments(const Name& batchName, const std::vector<shared_ptr<Data>>& records)
+{
+  Buffer buffer;
+  for (const auto& record : records) {
+    const auto& wire = record->wireEncode();
+    buffer.insert(buffer.end(), wire.begin(), wire.end());
+  }
+
+  std::vector<shared_ptr<Data>> segments;
+  size_t offset = 0;
+  do {
+    size_t segmentSize = std::min(MAX_SEGMENT_SIZE, buffer.size() - offset);
+    auto segment = make_shared<Data>(Name(batchName).appendSegment(segments.size()));
+    segment->setContent(buffer.data() + offset, segmentSize);
+    segment->setFreshnessPeriod(time::seconds(10));
+    segments.push_back(segment);
+    offset += segmentSize;
+  } while (offset < buffer.size());
+
+  auto finalBlock = name::Component::fromSegment(segments.size() - 1);
+  for (auto& segment : segments) {
+    segment->setFinalBlock(finalBlock);
+  }
+  return segments;
+}
+
+} // namespace dledger
@@ -0,0 +1,160 @@
+#ifndef DLEDGER_SRC_RECORD_BATCH_H_
+#define DLEDGER_SRC_RECORD_BATCH_H_
+
+#include "backend.hpp"
+
+#include <map>
+#include <vector>
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/name.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * A batch of records transferred with one Interest.
+ * Batch Interest Name: /<peer-prefix>/ANCESTORS/<depth>/<root-record>/<root-record>/...
+ *   each <root-record> component carries the TLV-encoded full name of a record.
+ * Batch Data Name: /<batch-name>/<segment>
+ * The batch carries the stored wire encoding of the ancestors of the root records
+ * (up to <depth> levels, roots and genesis records excluded), ordered from the deepest
+ * ancestor to the closest one, and split into segments.
+ */
+class RecordBatch
+{
+public:
+  /**
+   * @p maxSegments, input, the bound of the segment numbers, see getMaxSegmentCount
+   */
+  RecordBatch(const Name& batchName, size_t maxSegments);
+
+  const Name&
+  getName() const
+  {
+    return m_name;
+  }
+
+  /**
+   * Add a received segment.
+   * May throw exception if the segment number or the final segment number is out of bound
+   * @return true if the segment was not received before
+   */
+  bool
+  addSegment(const Data& segment);
+
+  bool
+  isComplete() const;
+
+  /**
+   * Get the index of the last segment, only known after a segment has been received.
+   */
+  optional<uint64_t>
+  getFinalSegment() const
+  {
+    return m_finalSegment;
+  }
+
+  /**
+   * Decode the records carried by a complete batch.
+   * May throw exception if the format is incorrect
+   */
+  std::vector<shared_ptr<Data>>
+  getRecords() const;
+
+  /**
+   * Decode the records carried by the segments received so far without gaps from
+   * the first segment, i.e., the deepest ancestors of the batch.
+   * Records which are split across a missing segment are not returned.
+   */
+  std::vector<shared_ptr<Data>>
+  getLeadingRecords() const;
+
+public:
+  static Name
+  makeBatchName(const Name& peerPrefix, size_t depth, const std::vector<Name>& roots);
+
+  /**
+   * Get the number of segments of a batch carrying up to @p maxRecords records of the largest packet size.
+   * The final segment number comes from the peer, so the segments fetched are bounded by it.
+   */
+  static size_t
+  getMaxSegmentCount(size_t maxRecords);
+
+  /**
+   * Check whether the name is a well formed batch name, with or without the trailing segment component.
+   */
+  static bool
+  isBatchName(const Name& name);
+
+  /**
+   * Parse a batch name, with or without the trailing segment component.
+   * @return false if the name is not a well formed batch name
+   */
+  static bool
+  parseBatchName(const Name& name, size_t& depth, std::vector<Name>& roots);
+
+  /**
+   * Get the prefix of the peer a batch is requested from.
+   */
+  static Name
+  getPeerPrefix(const Name& batchName);
+
+  /**
+   * Collect the ancestors of the roots from the backend, breadth first.
+   * @return the ancestors from the deepest to the closest
+   */
+  static std::vector<shared_ptr<Data>>
+  collectAncestors(const Backend& backend, const std::vector<Name>& roots, size_t depth, size_t maxRecords);
+
+  /**
+   * Compute the full names of records, digesting them together.
+   * A Data decoded from a batch has no cached full name, and the records of a batch
+   * are digested faster together than one by one.
+   */
+  static std::vector<Name>
+  computeFullNames(const std::vector<shared_ptr<Data>>& records);
+
+  /**
+   * Split the records into unsigned batch segments.
+   */
+  static std::vector<shared_ptr<Data>>
+  makeSegments(const Name& batchName, const std::vector<shared_ptr<Data>>& records);
+
+public:
+  /**
+   * The maximum content size of a batch segment.
+   */
+  const static size_t MAX_SEGMENT_SIZE = 7000;
+  /**
+   * The maximum number of roots named in one batch Interest.
+   */
+  const static size_t MAX_ROOTS = 8;
+
+private:
+  std::vector<shared_ptr<Data>>
+  decodeRecords(bool isComplete) const;
+
+  /**
+   * Find the ANCESTORS component of a batch name, followed by the depth, 1 to MAX_ROOTS root records
+   * and optionally the segment, and nothing else.
+   * @return nullopt if the name is not a well formed batch name
+   */
+  static optional<size_t>
+  findAncestorsComponent(const Name& name);
+
+  /**
+   * @return false if the component does not carry a TLV-encoded name
+   */
+  static bool
+  decodeRoot(const name::Component& component, Name& root);
+
+private:
+  Name m_name;
+  size_t m_maxSegments;
+  std::map<uint64_t, Block> m_segments;
+  optional<uint64_t> m_finalSegment;
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_SRC_RECORD_BATCH_H_
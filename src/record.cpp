@@ -1,11 +1,40 @@
 #include "dledger/record.hpp"
 #include "record_name.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <sstream>
 #include <utility>
+#include <boost/container/small_vector.hpp>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/util/sha256.hpp>
 
 namespace dledger {
 
+namespace {
+
+// walk the TLV elements in the block value without decoding them
+void
+checkElements(const Block& block)
+{
+  auto begin = block.value_begin();
+  auto end = block.value_end();
+  while (begin != end) {
+    uint32_t type = 0;
+    uint64_t length = 0;
+    if (!tlv::readType(begin, end, type) || !tlv::readVarNumber(begin, end, length) ||
+        length > static_cast<uint64_t>(std::distance(begin, end))) {
+      BOOST_THROW_EXCEPTION(tlv::Error("Bad TLV element in the record"));
+    }
+    begin += length;
+  }
+}
+
+} // namespace
+
+const size_t Record::BODY_SEGMENT_SIZE;
+const size_t Record::MAX_BODY_SEGMENTS;
+
 Record::Record(RecordType type, const std::string& identifer)
     : m_data(nullptr),
       m_type(type),
@@ -13,14 +42,31 @@ Record::Record(RecordType type, const std::string& identifer)
 {
 }
 
-Record::Record(const std::shared_ptr<Data>& data)
+Record::Record(const std::shared_ptr<const Data>& data)
     : m_data(data)
 {
-  RecordName name(m_data->getName());
-  m_type = name.getRecordType();
-  m_uniqueIdentifier = name.getRecordUniqueIdentifier();
-  headerWireDecode(m_data->getContent());
-  bodyWireDecode(m_data->getContent());
+  const auto& name = m_data->getName();
+  auto fields = RecordName::parse(name);
+  m_type = fields.recordType;
+  m_uniqueIdentifier = readString(name.get(fields.producerPrefixSize + 1));
+  m_producerPrefix = name.getPrefix(fields.producerPrefixSize);
+  m_generationTimestamp = fields.generationTimestamp;
+  const auto& content = m_data->getContent();
+  content.parse();
+  m_decoded = std::make_shared<DecodedContents>();
+  m_decoded->header = content.get(T_RecordHeader);
+  m_decoded->body = content.get(T_RecordContent);
+  checkElements(m_decoded->header);
+  checkElements(m_decoded->body);
+  if (m_type == RecordType::CERTIFICATE_RECORD) {
+    m_parsedCertificates = std::make_shared<ParsedCertificates>();
+  }
+}
+
+Record::Record(const std::shared_ptr<const Data>& data, const Name& fullName)
+    : Record(data)
+{
+  m_fullName = fullName;
 }
 
 Record::Record(ndn::Data data)
@@ -28,18 +74,42 @@ Record::Record(ndn::Data data)
 {
 }
 
-Name
+const Name&
 Record::getRecordName() const
 {
+  static const Name emptyName;
+  if (!m_fullName.empty())
+    return m_fullName;
   if (m_data != nullptr)
     return m_data->getFullName();
-  return Name();
+  return emptyName;
+}
+
+const Record::Contents&
+Record::getHeaderContents() const
+{
+  if (m_decoded == nullptr) {
+    return m_contents;
+  }
+  // a decoding that throws is tried again on the next access
+  std::call_once(m_decoded->headerDecoded, [this] { headerWireDecode(*m_decoded); });
+  return *m_decoded;
+}
+
+const Record::Contents&
+Record::getBodyContents() const
+{
+  if (m_decoded == nullptr) {
+    return m_contents;
+  }
+  std::call_once(m_decoded->bodyDecoded, [this] { bodyWireDecode(*m_decoded); });
+  return *m_decoded;
 }
 
-const std::list<Name>&
+const RecordPointers&
 Record::getPointersFromHeader() const
 {
-  return m_recordPointers;
+  return getHeaderContents().recordPointers;
 }
 
 void
@@ -48,19 +118,105 @@ Record::addRecordItem(const Block& recordItem)
   if (m_data != nullptr) {
     BOOST_THROW_EXCEPTION(std::runtime_error("Cannot modify built record"));
   }
-  m_contentItems.push_back(recordItem);
+  m_contents.itemTreeRoot = nullptr;
+  if (recordItem.hasWire()) {
+    m_contents.contentItems.push_back(recordItem);
+    return;
+  }
+  // the items are copied into the record encoding as they are
+  Block item(recordItem);
+  item.encode();
+  m_contents.contentItems.push_back(item);
 }
 
-const std::list<Block>&
+const RecordItems&
 Record::getRecordItems() const
 {
-  return m_contentItems;
+  return getBodyContents().contentItems;
+}
+
+bool
+Record::hasSegmentedBody() const
+{
+  return !getHeaderContents().bodySegmentDigests.empty();
+}
+
+void
+Record::addItemTree()
+{
+  if (m_data != nullptr) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Cannot modify built record"));
+  }
+  m_contents.hasItemTree = true;
+}
+
+bool
+Record::hasItemTree() const
+{
+  return getHeaderContents().hasItemTree;
+}
+
+void
+Record::checkItemTree() const
+{
+  const auto& header = getHeaderContents();
+  if (!header.hasItemTree) {
+    return;
+  }
+  const auto& items = getRecordItems();
+  if (items.size() != header.itemTreeCount ||
+      *ItemTree::computeRoot(items.data(), items.size()) != *header.itemTreeRoot) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Record items do not match the item tree"));
+  }
+}
+
+shared_ptr<Data>
+Record::makeItemData(size_t index) const
+{
+  if (!hasItemTree()) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Record without item tree"));
+  }
+  const auto& items = getRecordItems();
+  ItemProof proof(items.data(), items.size(), index);
+  auto content = makeEmptyBlock(tlv::Content);
+  content.push_back(items[index]);
+  content.push_back(proof.wireEncode());
+  content.encode();
+  auto data = make_shared<Data>(ItemProof::makeItemName(getRecordName(), index));
+  data->setContent(content);
+  data->setFreshnessPeriod(time::minutes(5));
+  return data;
+}
+
+Block
+Record::decodeItemData(const Data& itemData) const
+{
+  Name recordName;
+  size_t index = 0;
+  if (!ItemProof::parseItemName(itemData.getName(), recordName, index) || recordName != getRecordName()) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Not an item of the record"));
+  }
+  const auto& header = getHeaderContents();
+  if (!header.hasItemTree) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Record without item tree"));
+  }
+  const auto& content = itemData.getContent();
+  content.parse();
+  if (content.elements_size() != 2) {
+    BOOST_THROW_EXCEPTION(tlv::Error("Bad item content"));
+  }
+  const Block& item = content.elements()[0];
+  ItemProof proof(content.elements()[1]);
+  if (proof.getIndex() != index || !proof.verify(item, header.itemTreeCount, *header.itemTreeRoot)) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Item does not match the item tree"));
+  }
+  return item;
 }
 
 bool
 Record::isEmpty() const
 {
-  return m_data == nullptr && m_recordPointers.empty() && m_contentItems.empty();
+  return m_data == nullptr && m_contents.recordPointers.empty() && m_contents.contentItems.empty();
 }
 
 void
@@ -69,48 +225,190 @@ Record::addPointer(const Name& pointer)
   if (m_data != nullptr) {
       BOOST_THROW_EXCEPTION(std::runtime_error("Cannot modify built record"));
   }
-  m_recordPointers.push_back(pointer);
+  m_contents.recordPointers.push_back(pointer);
+}
+
+Block
+Record::wireEncode() const
+{
+  EncodingEstimator estimator;
+  size_t estimatedSize = wireEncode(estimator);
+  EncodingBuffer buffer(estimatedSize, 0);
+  wireEncode(buffer);
+  return buffer.block();
 }
 
 void
 Record::wireEncode(Block& block) const
 {
-  headerWireEncode(block);
-  bodyWireEncode(block);
+  auto content = wireEncode();
+  content.parse();
+  for (const auto& element : content.elements()) {
+    block.push_back(element);
+  }
 }
 
-Name
+template<encoding::Tag TAG>
+size_t
+Record::wireEncode(EncodingImpl<TAG>& encoder) const
+{
+  size_t totalLength = bodyWireEncode(encoder, !hasSegmentedBody());
+  totalLength += headerWireEncode(encoder);
+  totalLength += encoder.prependVarNumber(totalLength);
+  totalLength += encoder.prependVarNumber(tlv::Content);
+  return totalLength;
+}
+
+const Name&
 Record::getProducerPrefix() const
 {
-  return RecordName(m_data->getName()).getProducerPrefix();
+  // a record built locally has no parsed name until it is in the ledger
+  if (m_producerPrefix.empty() && m_data != nullptr) {
+    auto fields = RecordName::parse(m_data->getName());
+    m_producerPrefix = m_data->getName().getPrefix(fields.producerPrefixSize);
+    m_generationTimestamp = fields.generationTimestamp;
+  }
+  return m_producerPrefix;
 }
 
 time::system_clock::TimePoint
 Record::getGenerationTimestamp() const
 {
-  return RecordName(m_data->getName()).getGenerationTimestamp();
+  getProducerPrefix();
+  return m_generationTimestamp;
+}
+
+std::vector<shared_ptr<Data>>
+Record::makeBodySegments(const Name& dataName) const
+{
+  std::vector<shared_ptr<Data>> segments;
+  EncodingEstimator estimator;
+  size_t bodySize = bodyWireEncode(estimator, true);
+  if (bodySize <= BODY_SEGMENT_SIZE) {
+    return segments;
+  }
+  EncodingBuffer body(bodySize, 0);
+  bodyWireEncode(body, true);
+
+  for (size_t offset = 0; offset < bodySize; offset += BODY_SEGMENT_SIZE) {
+    auto segment = make_shared<Data>(Name(dataName).appendSegment(segments.size()));
+    segment->setContent(body.buf() + offset, std::min(BODY_SEGMENT_SIZE, bodySize - offset));
+    segment->setFreshnessPeriod(time::minutes(5));
+    segments.push_back(segment);
+  }
+  auto finalBlock = name::Component::fromSegment(segments.size() - 1);
+  for (auto& segment : segments) {
+    segment->setFinalBlock(finalBlock);
+  }
+  return segments;
+}
+
+void
+Record::setBodySegments(const std::vector<shared_ptr<Data>>& segments)
+{
+  if (m_data != nullptr) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Cannot modify built record"));
+  }
+  m_contents.bodySegmentDigests.clear();
+  for (const auto& segment : segments) {
+    m_contents.bodySegmentDigests.push_back(segment->getFullName().get(-1));
+  }
+}
+
+std::vector<Name>
+Record::getBodySegmentNames() const
+{
+  const auto& digests = getHeaderContents().bodySegmentDigests;
+  std::vector<Name> segmentNames;
+  for (size_t i = 0; i < digests.size(); i++) {
+    segmentNames.push_back(Name(m_data->getName()).appendSegment(i).append(digests[i]));
+  }
+  return segmentNames;
 }
 
 void
-Record::headerWireEncode(Block& block) const
+Record::decodeBodySegments(const std::vector<shared_ptr<const Data>>& segments)
+{
+  // from now on the record keeps its own contents, the copies sharing the decoded ones are left as they are
+  const auto& header = getHeaderContents();
+  Contents contents;
+  contents.recordPointers = header.recordPointers;
+  contents.bodySegmentDigests = header.bodySegmentDigests;
+  contents.hasItemTree = header.hasItemTree;
+  contents.itemTreeCount = header.itemTreeCount;
+  contents.itemTreeRoot = header.itemTreeRoot;
+  const auto& digests = contents.bodySegmentDigests;
+  if (segments.size() != digests.size()) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Wrong number of body segments"));
+  }
+  auto buffer = make_shared<Buffer>();
+  for (size_t i = 0; i < segments.size(); i++) {
+    if (segments[i]->getFullName().get(-1) != digests[i]) {
+      BOOST_THROW_EXCEPTION(std::runtime_error("Body segment does not match the header"));
+    }
+    const auto& content = segments[i]->getContent();
+    buffer->insert(buffer->end(), content.value_begin(), content.value_end());
+  }
+  Block body(buffer);
+  if (body.type() != T_RecordContent) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Bad body type"));
+  }
+  body.parse();
+  contents.contentItems.assign(body.elements_begin(), body.elements_end());
+  m_contents = std::move(contents);
+  m_decoded = nullptr;
+  if (m_parsedCertificates != nullptr) {
+    // the certificates are in the body just decoded
+    m_parsedCertificates = std::make_shared<ParsedCertificates>();
+  }
+}
+
+template<encoding::Tag TAG>
+size_t
+Record::headerWireEncode(EncodingImpl<TAG>& encoder) const
 {
-  auto header = makeEmptyBlock(T_RecordHeader);
-  for (const auto& pointer : m_recordPointers) {
-    header.push_back(pointer.wireEncode());
+  const auto& header = getHeaderContents();
+  size_t totalLength = 0;
+  if (!header.bodySegmentDigests.empty()) {
+    size_t manifestLength = 0;
+    for (auto it = header.bodySegmentDigests.rbegin(); it != header.bodySegmentDigests.rend(); it++) {
+      manifestLength += encoder.prependBlock(*it);
+    }
+    manifestLength += encoder.prependVarNumber(manifestLength);
+    manifestLength += encoder.prependVarNumber(T_BodyManifest);
+    totalLength += manifestLength;
+  }
+  if (header.hasItemTree) {
+    if (header.itemTreeRoot == nullptr) {
+      // only a record built locally, which is not shared yet, has no root
+      const auto& items = getRecordItems();
+      header.itemTreeCount = items.size();
+      header.itemTreeRoot = ItemTree::computeRoot(items.data(), items.size());
+    }
+    size_t treeLength = encoder.prependByteArrayBlock(ItemProof::T_ItemRoot, header.itemTreeRoot->data(),
+                                                      header.itemTreeRoot->size());
+    treeLength += prependNonNegativeIntegerBlock(encoder, ItemProof::T_ItemCount, header.itemTreeCount);
+    treeLength += encoder.prependVarNumber(treeLength);
+    treeLength += encoder.prependVarNumber(ItemProof::T_ItemTree);
+    totalLength += treeLength;
+  }
+  for (auto it = header.recordPointers.rbegin(); it != header.recordPointers.rend(); it++) {
+    totalLength += it->wireEncode(encoder);
   }
-  header.parse();
-  block.push_back(header);
-  block.parse();
-};
+  totalLength += encoder.prependVarNumber(totalLength);
+  totalLength += encoder.prependVarNumber(T_RecordHeader);
+  return totalLength;
+}
 
 void
-Record::headerWireDecode(const Block& dataContent) {
-    m_recordPointers.clear();
-    dataContent.parse();
-    const auto &headerBlock = dataContent.get(T_RecordHeader);
-    headerBlock.parse();
+Record::headerWireDecode(DecodedContents& contents)
+{
+    contents.recordPointers.clear();
+    contents.bodySegmentDigests.clear();
+    contents.hasItemTree = false;
+    contents.header.parse();
     Name pointer;
-    for (const auto &item : headerBlock.elements()) {
+    for (const auto &item : contents.header.elements()) {
         if (item.type() == tlv::Name) {
             try {
                 pointer.wireDecode(item);
@@ -118,34 +416,59 @@ Record::headerWireDecode(const Block& dataContent) {
                 std::cout << (e.what());
             }
 
-            m_recordPointers.push_back(pointer);
+            contents.recordPointers.push_back(pointer);
+        } else if (item.type() == T_BodyManifest) {
+            item.parse();
+            contents.bodySegmentDigests.clear();
+            for (const auto &digest : item.elements()) {
+                contents.bodySegmentDigests.emplace_back(digest);
+                if (!contents.bodySegmentDigests.back().isImplicitSha256Digest()) {
+                    BOOST_THROW_EXCEPTION(std::runtime_error("Bad body segment digest"));
+                }
+            }
+        } else if (item.type() == ItemProof::T_ItemTree) {
+            item.parse();
+            const auto& count = item.get(ItemProof::T_ItemCount);
+            const auto& root = item.get(ItemProof::T_ItemRoot);
+            if (root.value_size() != util::Sha256::DIGEST_SIZE) {
+                BOOST_THROW_EXCEPTION(std::runtime_error("Bad item tree root"));
+            }
+            contents.itemTreeCount = readNonNegativeInteger(count);
+            contents.itemTreeRoot = make_shared<Buffer>(root.value(), root.value_size());
+            contents.hasItemTree = true;
         } else {
             BOOST_THROW_EXCEPTION(std::runtime_error("Bad header item type"));
         }
     }
 }
 
-void
-Record::bodyWireEncode(Block& block) const
+template<encoding::Tag TAG>
+size_t
+Record::bodyWireEncode(EncodingImpl<TAG>& encoder, bool withItems) const
 {
-  auto body = makeEmptyBlock(T_RecordContent);
-  for (const auto& item : m_contentItems) {
-    body.push_back(item);
+  size_t totalLength = 0;
+  if (withItems) {
+    const auto& items = getRecordItems();
+    for (auto it = items.rbegin(); it != items.rend(); it++) {
+      totalLength += encoder.prependBlock(*it);
+    }
   }
-  body.parse();
-  block.push_back(body);
-  block.parse();
-};
+  totalLength += encoder.prependVarNumber(totalLength);
+  totalLength += encoder.prependVarNumber(T_RecordContent);
+  return totalLength;
+}
+
+template size_t
+Record::wireEncode<encoding::EncoderTag>(EncodingImpl<encoding::EncoderTag>& encoder) const;
 
+template size_t
+Record::wireEncode<encoding::EstimatorTag>(EncodingImpl<encoding::EstimatorTag>& encoder) const;
 void
-Record::bodyWireDecode(const Block& dataContent) {
-    m_contentItems.clear();
-    dataContent.parse();
-    const auto &contentBlock = dataContent.get(T_RecordContent);
-    contentBlock.parse();
-    for (const auto &item : contentBlock.elements()) {
-        m_contentItems.push_back(item);
-    }
+Record::bodyWireDecode(DecodedContents& contents)
+{
+    // the items share the wire of the Data packet
+    contents.body.parse();
+    contents.contentItems.assign(contents.body.elements_begin(), contents.body.elements_end());
 }
 
 void
@@ -154,11 +477,15 @@ Record::checkPointerCount(int numPointers) const{
         throw std::runtime_error("Less preceding record than expected");
     }
 
-    std::set<Name> nameSet;
+    // a handful of pointers: compare them in place rather than copying them into a set
+    boost::container::small_vector<const Name*, 8> pointers;
     for (const auto& pointer: getPointersFromHeader()) {
-        nameSet.insert(pointer);
+        pointers.push_back(&pointer);
     }
-    if (nameSet.size() != numPointers) {
+    std::sort(pointers.begin(), pointers.end(), [] (const Name* lhs, const Name* rhs) { return *lhs < *rhs; });
+    auto repeated = std::adjacent_find(pointers.begin(), pointers.end(),
+                                       [] (const Name* lhs, const Name* rhs) { return *lhs == *rhs; });
+    if (repeated != pointers.end()) {
         throw std::runtime_error("Repeated preceding Records");
     }
 }
@@ -180,15 +507,34 @@ CertificateRecord::CertificateRecord(Record record)
         BOOST_THROW_EXCEPTION(std::runtime_error("incorrect record type"));
     }
 
-    for (const Block& block : this->getRecordItems()) {
+    if (m_parsedCertificates == nullptr) {
+        parseItems(getRecordItems(), m_cert_list, m_prev_cert);
+        return;
+    }
+    std::call_once(m_parsedCertificates->parsed, [this] {
+        // a failed parse leaves nothing behind and is tried again by the next copy
+        std::vector<security::Certificate> certificates;
+        std::vector<Name> prevCertificates;
+        parseItems(getRecordItems(), certificates, prevCertificates);
+        m_parsedCertificates->certificates = std::move(certificates);
+        m_parsedCertificates->prevCertificates = std::move(prevCertificates);
+    });
+}
+
+void
+CertificateRecord::parseItems(const RecordItems& items, std::vector<security::Certificate>& certificates,
+                              std::vector<Name>& prevCertificates)
+{
+    certificates.reserve(items.size());
+    for (const Block& block : items) {
         if (block.type() == tlv::KeyLocator) {
             Name recordName = KeyLocator(block).getName();
             if (!recordName.empty()) {
                 RecordName r(recordName); // to check record name format
             }
-            m_prev_cert.emplace_back(recordName);
+            prevCertificates.emplace_back(recordName);
         } else {
-            m_cert_list.emplace_back(block);
+            certificates.emplace_back(block);
         }
     }
 }
@@ -200,9 +546,12 @@ CertificateRecord::addCertificateItem(const security::Certificate& certificate)
     addRecordItem(certificate.wireEncode());
 }
 
-const std::list<security::Certificate> &
+const std::vector<security::Certificate> &
 CertificateRecord::getCertificates() const
 {
+    if (m_parsedCertificates != nullptr) {
+        return m_parsedCertificates->certificates;
+    }
     return m_cert_list;
 }
 
@@ -212,8 +561,11 @@ CertificateRecord::addPrevCertPointer(const Name& recordName){
     addRecordItem(KeyLocator(recordName).wireEncode());
 }
 
-const std::list<Name> &
+const std::vector<Name> &
 CertificateRecord::getPrevCertificates() const{
+    if (m_parsedCertificates != nullptr) {
+        return m_parsedCertificates->prevCertificates;
+    }
     return m_prev_cert;
 }
 
@@ -237,7 +589,7 @@ RevocationRecord::addCertificateNameItem(const Name &certificateName){
     addRecordItem(certificateName.wireEncode());
 }
 
-const std::list<Name> &
+const std::vector<Name> &
 RevocationRecord::getRevokedCertificates() const{
     return m_revoked_cert_list;
 }
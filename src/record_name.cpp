@@ -4,52 +4,83 @@
 
 #include "record_name.hpp"
 
+#include <algorithm>
+
 using namespace ndn;
 namespace dledger {
+
+namespace {
+
+// the same as stringToRecordType, without copying the component into a string
+RecordType componentToRecordType(const name::Component &component) {
+    for (auto type : {RecordType::GENERIC_RECORD, RecordType::CERTIFICATE_RECORD,
+                      RecordType::REVOCATION_RECORD, RecordType::GENESIS_RECORD}) {
+        const auto &typeString = recordTypeToString(type);
+        if (component.value_size() == typeString.size() &&
+            std::equal(typeString.begin(), typeString.end(), component.value_begin())) {
+            return type;
+        }
+    }
+    return RecordType::BASE_RECORD;
+}
+
+} // namespace
+
 // record Name: /<producer-prefix>/<record-type>/<record-name>/<timestamp>
-RecordName::RecordName(const Name &name) : Name(name) {
-    if (this->size() < 4 || (hasImplicitDigest() && this->size() < 5))
-        BOOST_THROW_EXCEPTION(std::runtime_error("record name too short"));
-    getGenerationTimestamp();
-    if (getRecordType() == RecordType::BASE_RECORD)
-        BOOST_THROW_EXCEPTION(std::runtime_error("record name invalid type"));
+RecordName::RecordName(const Name &name) : m_name(name), m_fields(parse(name)) {
 }
 
 RecordName::RecordName(const Name &peerPrefix, RecordType type, const std::string &identifier,
                        time::system_clock::TimePoint time) :
-        Name(peerPrefix) {
-    this->append(recordTypeToString(type));
-    append(identifier);
-    appendTimestamp(time);
+        m_name(peerPrefix) {
+    m_name.append(recordTypeToString(type));
+    m_name.append(identifier);
+    m_name.appendTimestamp(time);
+    // the timestamp is read back from the name, which keeps microseconds only
+    m_fields = parse(m_name);
+}
+
+RecordNameFields RecordName::parse(const Name &name) {
+    bool hasDigest = !name.empty() && name.get(-1).isImplicitSha256Digest();
+    if (name.size() < 4 || (hasDigest && name.size() < 5))
+        BOOST_THROW_EXCEPTION(std::runtime_error("record name too short"));
+    int numSuffix = hasDigest ? 4 : 3;
+    RecordNameFields fields;
+    fields.producerPrefixSize = name.size() - numSuffix;
+    fields.generationTimestamp = name.get(-numSuffix + 2).toTimestamp();
+    fields.recordType = componentToRecordType(name.get(-numSuffix));
+    if (fields.recordType == RecordType::BASE_RECORD)
+        BOOST_THROW_EXCEPTION(std::runtime_error("record name invalid type"));
+    return fields;
+}
+
+bool RecordName::isProducedBy(const Name &recordName, const Name &producerPrefix) {
+    return parse(recordName).producerPrefixSize == producerPrefix.size() && producerPrefix.isPrefixOf(recordName);
 }
 
 Name RecordName::getProducerPrefix() const {
-    int numSuffix = hasImplicitDigest() ? 4 : 3;
-    return this->getPrefix(size() - numSuffix);
+    return m_name.getPrefix(m_fields.producerPrefixSize);
 }
 
 RecordType RecordName::getRecordType() const {
-    int location = hasImplicitDigest() ? -4 : -3;
-    return stringToRecordType(readString(get(location)));
+    return m_fields.recordType;
 }
 
 std::string RecordName::getRecordUniqueIdentifier() const {
-    int location = hasImplicitDigest() ? -3 : -2;
-    return readString(get(location));
+    return readString(m_name.get(m_fields.producerPrefixSize + 1));
 }
 
 time::system_clock::TimePoint RecordName::getGenerationTimestamp() const {
-    int location = hasImplicitDigest() ? -2 : -1;
-    return get(location).toTimestamp();
+    return m_fields.generationTimestamp;
 }
 
 bool RecordName::hasImplicitDigest() const {
-    return this->get(-1).isImplicitSha256Digest();
+    return m_name.get(-1).isImplicitSha256Digest();
 }
 
 std::string RecordName::getImplicitDigest() const {
     if (hasImplicitDigest())
-        return readString(this->get(-1));
+        return readString(m_name.get(-1));
     else
         return "";
 }
@@ -12,11 +12,31 @@
 using namespace ndn;
 namespace dledger {
 
-class RecordName: public Name {
+/**
+ * The fields of a record name, parsed once.
+ */
+struct RecordNameFields {
+    size_t producerPrefixSize; // the record type component follows the producer prefix
+    RecordType recordType;
+    time::system_clock::TimePoint generationTimestamp;
+};
+
+/**
+ * A record name and its fields, parsed once.
+ * The name cannot be modified, so that the fields always match it; it is used wherever a Name is expected.
+ */
+class RecordName {
 public:
     // record Name: /<producer-prefix>/<record-type>/<record-name>/<timestamp>
     RecordName(const Name& name);
     RecordName(const Name& peerPrefix, RecordType type, const std::string &identifier, time::system_clock::TimePoint time=time::system_clock::now());
+
+    operator const Name&() const {
+        return m_name;
+    }
+    const Name& getName() const {
+        return m_name;
+    }
     Name getProducerPrefix() const;
     RecordType getRecordType() const;
     std::string getRecordUniqueIdentifier() const;
@@ -24,8 +44,24 @@ public:
     bool hasImplicitDigest() const;
     std::string getImplicitDigest() const;
 
+    /**
+     * Parse the fields of a record name without copying the name.
+     * May throw exception if the name is not a record name
+     */
+    static RecordNameFields parse(const Name &name);
+
+    /**
+     * Check whether a record is produced by the producer, without copying the producer prefix.
+     * May throw exception if the name is not a record name
+     */
+    static bool isProducedBy(const Name &recordName, const Name &producerPrefix);
+
     //generate names
     static RecordName generateRecordName(const Config& config, const Record& record);
+
+private:
+    Name m_name;
+    RecordNameFields m_fields;
     };
 
 }
@@ -0,0 +1,433 @@
+#include "sha256-batch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <boost/throw_exception.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DLEDGER_SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace dledger {
+
+namespace {
+
+const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const uint32_t INITIAL_STATE[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/**
+ * A message as its whole 64-byte blocks, read in place, followed by the padded tail.
+ */
+class PaddedMessage
+{
+public:
+  explicit
+  PaddedMessage(const DigestInput& input)
+    : m_data(input.data)
+    , m_fullBlocks(input.size / 64)
+  {
+    size_t rest = input.size % 64;
+    m_tailBlocks = rest + 9 > 64 ? 2 : 1;
+    std::memset(m_tail, 0, sizeof(m_tail));
+    if (rest > 0) {
+      std::memcpy(m_tail, input.data + m_fullBlocks * 64, rest);
+    }
+    m_tail[rest] = 0x80;
+    uint64_t bitLength = static_cast<uint64_t>(input.size) * 8;
+    uint8_t* lengthField = m_tail + m_tailBlocks * 64 - 8;
+    for (int i = 0; i < 8; i++) {
+      lengthField[i] = static_cast<uint8_t>(bitLength >> (56 - 8 * i));
+    }
+  }
+
+  size_t
+  getBlockCount() const
+  {
+    return m_fullBlocks + m_tailBlocks;
+  }
+
+  const uint8_t*
+  getBlock(size_t i) const
+  {
+    return i < m_fullBlocks ? m_data + i * 64 : m_tail + (i - m_fullBlocks) * 64;
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_fullBlocks;
+  size_t m_tailBlocks;
+  uint8_t m_tail[128];
+};
+
+inline uint32_t
+loadBigEndian(const uint8_t* p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void
+storeBigEndian(uint8_t* p, uint32_t value)
+{
+  p[0] = static_cast<uint8_t>(value >> 24);
+  p[1] = static_cast<uint8_t>(value >> 16);
+  p[2] = static_cast<uint8_t>(value >> 8);
+  p[3] = static_cast<uint8_t>(value);
+}
+
+Sha256Digest
+toDigest(const uint32_t state[8])
+{
+  Sha256Digest digest;
+  for (int i = 0; i < 8; i++) {
+    storeBigEndian(digest.data() + 4 * i, state[i]);
+  }
+  return digest;
+}
+
+inline uint32_t
+rotr(uint32_t x, int n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+void
+compressPortable(uint32_t state[8], const uint8_t* block)
+{
+  uint32_t w[64];
+  for (int t = 0; t < 16; t++) {
+    w[t] = loadBigEndian(block + 4 * t);
+  }
+  for (int t = 16; t < 64; t++) {
+    uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+    uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+    w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int t = 0; t < 64; t++) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+Sha256Digest
+digestPortable(const DigestInput& input)
+{
+  PaddedMessage message(input);
+  uint32_t state[8];
+  std::copy(INITIAL_STATE, INITIAL_STATE + 8, state);
+  for (size_t i = 0; i < message.getBlockCount(); i++) {
+    compressPortable(state, message.getBlock(i));
+  }
+  return toDigest(state);
+}
+
+#ifdef DLEDGER_SHA256_X86
+
+bool
+hasShaNi()
+{
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_SSE4_1) == 0) {
+    return false;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (ebx & (1u << 29)) != 0; // SHA
+}
+
+bool
+hasAvx2()
+{
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) {
+    return false;
+  }
+  // the OS saves the AVX registers
+  unsigned xcr0Low, xcr0High;
+  __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+  if ((xcr0Low & 6) != 6) {
+    return false;
+  }
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (ebx & bit_AVX2) != 0;
+}
+
+__attribute__((target("sha,sse4.1")))
+void
+compressShaNi(uint32_t state[8], const uint8_t* block)
+{
+  const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // the SHA instructions keep the state as ABEF and CDGH
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+  const __m128i abefSave = state0;
+  const __m128i cdghSave = state1;
+
+  // message words of the last four groups of four rounds
+  __m128i w[4];
+  for (int i = 0; i < 16; i++) {
+    if (i < 4) {
+      w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i)), byteSwap);
+    }
+    else {
+      __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]),
+                                  _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+      w[i % 4] = _mm_sha256msg2_epu32(sum, w[(i + 3) % 4]);
+    }
+    __m128i message = _mm_add_epi32(w[i % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + 4 * i)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+  }
+
+  state0 = _mm_add_epi32(state0, abefSave);
+  state1 = _mm_add_epi32(state1, cdghSave);
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, state1, 0xF0));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+Sha256Digest
+digestShaNi(const DigestInput& input)
+{
+  PaddedMessage message(input);
+  uint32_t state[8];
+  std::copy(INITIAL_STATE, INITIAL_STATE + 8, state);
+  for (size_t i = 0; i < message.getBlockCount(); i++) {
+    compressShaNi(state, message.getBlock(i));
+  }
+  return toDigest(state);
+}
+
+const size_t LANES = 8;
+
+__attribute__((target("avx2")))
+inline __m256i
+rotr8(__m256i x, int n)
+{
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+/**
+ * Run one block of each lane, lanes outside of @p activeMask keep their state.
+ */
+__attribute__((target("avx2")))
+void
+compressAvx2(__m256i state[8], const uint8_t* const blocks[LANES], __m256i activeMask)
+{
+  __m256i w[16];
+  for (int t = 0; t < 16; t++) {
+    w[t] = _mm256_setr_epi32(loadBigEndian(blocks[0] + 4 * t), loadBigEndian(blocks[1] + 4 * t),
+                             loadBigEndian(blocks[2] + 4 * t), loadBigEndian(blocks[3] + 4 * t),
+                             loadBigEndian(blocks[4] + 4 * t), loadBigEndian(blocks[5] + 4 * t),
+                             loadBigEndian(blocks[6] + 4 * t), loadBigEndian(blocks[7] + 4 * t));
+  }
+
+  __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+  __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int t = 0; t < 64; t++) {
+    __m256i word;
+    if (t < 16) {
+      word = w[t];
+    }
+    else {
+      // the schedule is kept in a ring of the last 16 words
+      __m256i w15 = w[(t - 15) % 16];
+      __m256i w2 = w[(t - 2) % 16];
+      __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w15, 7), rotr8(w15, 18)), _mm256_srli_epi32(w15, 3));
+      __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w2, 17), rotr8(w2, 19)), _mm256_srli_epi32(w2, 10));
+      word = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0), _mm256_add_epi32(w[(t - 7) % 16], s1));
+      w[t % 16] = word;
+    }
+    __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25));
+    __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                                  _mm256_add_epi32(choose, _mm256_add_epi32(_mm256_set1_epi32(K[t]), word)));
+    __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22));
+    __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    __m256i t2 = _mm256_add_epi32(sigma0, majority);
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  const __m256i result[8] = {a, b, c, d, e, f, g, h};
+  for (int i = 0; i < 8; i++) {
+    state[i] = _mm256_blendv_epi8(state[i], _mm256_add_epi32(state[i], result[i]), activeMask);
+  }
+}
+
+/**
+ * Digest up to eight messages together.
+ */
+__attribute__((target("avx2")))
+void
+digestAvx2Lanes(const std::vector<DigestInput>& inputs, const size_t* indexes, size_t count,
+                std::vector<Sha256Digest>& digests)
+{
+  std::vector<PaddedMessage> messages;
+  messages.reserve(LANES);
+  size_t maxBlocks = 0;
+  for (size_t lane = 0; lane < count; lane++) {
+    messages.emplace_back(inputs[indexes[lane]]);
+    maxBlocks = std::max(maxBlocks, messages.back().getBlockCount());
+  }
+
+  __m256i state[8];
+  for (int i = 0; i < 8; i++) {
+    state[i] = _mm256_set1_epi32(INITIAL_STATE[i]);
+  }
+  for (size_t i = 0; i < maxBlocks; i++) {
+    // an idle lane hashes a block of another lane and drops the result
+    const uint8_t* blocks[LANES];
+    alignas(32) int32_t active[LANES];
+    for (size_t lane = 0; lane < LANES; lane++) {
+      bool isActive = lane < count && i < messages[lane].getBlockCount();
+      blocks[lane] = isActive ? messages[lane].getBlock(i) : messages[0].getBlock(0);
+      active[lane] = isActive ? -1 : 0;
+    }
+    compressAvx2(state, blocks, _mm256_load_si256(reinterpret_cast<const __m256i*>(active)));
+  }
+
+  alignas(32) uint32_t words[8][LANES];
+  for (int i = 0; i < 8; i++) {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), state[i]);
+  }
+  for (size_t lane = 0; lane < count; lane++) {
+    uint32_t laneState[8];
+    for (int i = 0; i < 8; i++) {
+      laneState[i] = words[i][lane];
+    }
+    digests[indexes[lane]] = toDigest(laneState);
+  }
+}
+
+void
+digestAvx2(const std::vector<DigestInput>& inputs, std::vector<Sha256Digest>& digests)
+{
+  // lanes of similar length finish together
+  std::vector<size_t> indexes(inputs.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  std::sort(indexes.begin(), indexes.end(), [&inputs] (size_t x, size_t y) {
+    return inputs[x].size < inputs[y].size;
+  });
+  for (size_t i = 0; i < indexes.size(); i += LANES) {
+    size_t count = std::min(LANES, indexes.size() - i);
+    if (count < 3) {
+      // a few lanes do not pay for the wide registers
+      for (size_t j = i; j < i + count; j++) {
+        digests[indexes[j]] = digestPortable(inputs[indexes[j]]);
+      }
+      continue;
+    }
+    digestAvx2Lanes(inputs, indexes.data() + i, count, digests);
+  }
+}
+
+#endif // DLEDGER_SHA256_X86
+
+} // namespace
+
+bool
+isSha256KernelSupported(Sha256Kernel kernel)
+{
+  switch (kernel) {
+#ifdef DLEDGER_SHA256_X86
+  case Sha256Kernel::SHA_NI: {
+    static const bool isSupported = hasShaNi();
+    return isSupported;
+  }
+  case Sha256Kernel::AVX2_MULTI_BUFFER: {
+    static const bool isSupported = hasAvx2();
+    return isSupported;
+  }
+#endif
+  case Sha256Kernel::PORTABLE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+Sha256Kernel
+getBestSha256Kernel()
+{
+  // the SHA extensions run one buffer faster than the eight AVX2 lanes run eight
+  if (isSha256KernelSupported(Sha256Kernel::SHA_NI)) {
+    return Sha256Kernel::SHA_NI;
+  }
+  if (isSha256KernelSupported(Sha256Kernel::AVX2_MULTI_BUFFER)) {
+    return Sha256Kernel::AVX2_MULTI_BUFFER;
+  }
+  return Sha256Kernel::PORTABLE;
+}
+
+std::vector<Sha256Digest>
+computeSha256Batch(const std::vector<DigestInput>& inputs)
+{
+  return computeSha256Batch(inputs, getBestSha256Kernel());
+}
+
+std::vector<Sha256Digest>
+computeSha256Batch(const std::vector<DigestInput>& inputs, Sha256Kernel kernel)
+{
+  if (!isSha256KernelSupported(kernel)) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("SHA-256 kernel not supported by the CPU"));
+  }
+  std::vector<Sha256Digest> digests(inputs.size());
+  switch (kernel) {
+#ifdef DLEDGER_SHA256_X86
+  case Sha256Kernel::SHA_NI:
+    std::transform(inputs.begin(), inputs.end(), digests.begin(), digestShaNi);
+    break;
+  case Sha256Kernel::AVX2_MULTI_BUFFER:
+    digestAvx2(inputs, digests);
+    break;
+#endif
+  default:
+    std::transform(inputs.begin(), inputs.end(), digests.begin(), digestPortable);
+    break;
+  }
+  return digests;
+}
+
+} // namespace dledger
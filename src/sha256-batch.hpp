@@ -0,0 +1,56 @@
+#ifndef DLEDGER_SRC_SHA256_BATCH_H_
+#define DLEDGER_SRC_SHA256_BATCH_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dledger {
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+struct DigestInput
+{
+  const uint8_t* data;
+  size_t size;
+};
+
+enum class Sha256Kernel {
+  PORTABLE,
+  /**
+   * One buffer at a time with the x86 SHA extensions.
+   */
+  SHA_NI,
+  /**
+   * Eight buffers at a time, one per 32-bit lane of the AVX2 registers.
+   */
+  AVX2_MULTI_BUFFER,
+};
+
+bool
+isSha256KernelSupported(Sha256Kernel kernel);
+
+/**
+ * Get the fastest kernel supported by the CPU, checked once at run time.
+ */
+Sha256Kernel
+getBestSha256Kernel();
+
+/**
+ * Compute the SHA-256 digests of several buffers with the fastest kernel.
+ * @return one digest per input, in the same order
+ */
+std::vector<Sha256Digest>
+computeSha256Batch(const std::vector<DigestInput>& inputs);
+
+/**
+ * Compute the SHA-256 digests of several buffers with the given kernel.
+ * May throw exception if the kernel is not supported by the CPU
+ */
+std::vector<Sha256Digest>
+computeSha256Batch(const std::vector<DigestInput>& inputs, Sha256Kernel kernel);
+
+} // namespace dledger
+
+#endif // DLEDGER_SRC_SHA256_BATCH_H_
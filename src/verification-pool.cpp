@@ -0,0 +1,127 @@
+#include "verification-pool.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace dledger {
+
+const size_t VerificationPool::MAX_BATCH_SIZE = 64;
+
+VerificationPool::VerificationPool(boost::asio::io_service& ioService, size_t nThreads, const VerifyFunction& verify)
+    : m_ioService(ioService)
+    , m_verify(verify)
+    , m_nThreads(nThreads)
+    , m_isAlive(make_shared<bool>(true))
+{
+  for (size_t i = 0; i < nThreads; i++) {
+    m_workers.emplace_back(&VerificationPool::runWorker, this);
+  }
+}
+
+VerificationPool::~VerificationPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopped = true;
+    // results posted from now on are dropped
+    m_isAlive.reset();
+  }
+  m_jobAvailable.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void
+VerificationPool::verify(const shared_ptr<const Data>& data, const DoneCallback& done)
+{
+  if (m_nThreads == 0) {
+    VerificationResult result;
+    try {
+      auto results = m_verify({data});
+      if (!results.empty()) {
+        result = results.front();
+      }
+    } catch (const std::exception& e) {
+      // a record that cannot be verified is a bad record
+    }
+    done(result);
+    return;
+  }
+  uint64_t sequence = m_nextSequence++;
+  m_callbacks[sequence] = done;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(Job{sequence, data});
+  }
+  m_jobAvailable.notify_one();
+}
+
+void
+VerificationPool::runWorker()
+{
+  while (true) {
+    std::vector<Job> jobs;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobAvailable.wait(lock, [this] { return m_isStopped || !m_jobs.empty(); });
+      if (m_isStopped) {
+        return;
+      }
+      // share the queue among the workers rather than one taking it all
+      size_t batchSize = std::min(MAX_BATCH_SIZE, (m_jobs.size() + m_nThreads - 1) / m_nThreads);
+      auto end = m_jobs.begin() + batchSize;
+      jobs.assign(std::make_move_iterator(m_jobs.begin()), std::make_move_iterator(end));
+      m_jobs.erase(m_jobs.begin(), end);
+    }
+
+    std::vector<shared_ptr<const Data>> batch;
+    batch.reserve(jobs.size());
+    for (const auto& job : jobs) {
+      batch.push_back(job.data);
+    }
+    std::vector<VerificationResult> results;
+    try {
+      results = m_verify(batch);
+    } catch (const std::exception& e) {
+      // a record that cannot be verified is a bad record
+    }
+    results.resize(jobs.size());
+
+    std::weak_ptr<bool> isAlive;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (size_t i = 0; i < jobs.size(); i++) {
+        m_results[jobs[i].sequence] = results[i];
+      }
+      isAlive = m_isAlive;
+    }
+    m_ioService.post([this, isAlive] {
+      if (isAlive.lock()) {
+        deliverResults();
+      }
+    });
+  }
+}
+
+void
+VerificationPool::deliverResults()
+{
+  std::vector<std::pair<DoneCallback, VerificationResult>> ready;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_results.begin(); it != m_results.end() && it->first == m_nextToDeliver;
+         it = m_results.erase(it)) {
+      auto callback = m_callbacks.find(m_nextToDeliver);
+      ready.emplace_back(std::move(callback->second), it->second);
+      m_callbacks.erase(callback);
+      m_nextToDeliver++;
+    }
+  }
+  // the callbacks may submit more records
+  for (const auto& item : ready) {
+    item.first(item.second);
+  }
+}
+
+} // namespace dledger
@@ -0,0 +1,113 @@
+#ifndef DLEDGER_SRC_VERIFICATION_POOL_H_
+#define DLEDGER_SRC_VERIFICATION_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/asio/io_service.hpp>
+#include <ndn-cxx/data.hpp>
+
+using namespace ndn;
+namespace dledger {
+
+/**
+ * The signature checks of a record.
+ */
+struct VerificationResult
+{
+  /**
+   * The record is signed by a known certificate, revoked or not.
+   */
+  bool signatureValid = false;
+  /**
+   * The record is signed by a certificate which is not revoked.
+   */
+  bool endorsed = false;
+};
+
+/**
+ * Runs the signature verification of records on worker threads.
+ * A worker takes the queued records in batches, so a burst of records is verified together.
+ * The results are posted back to the io_service thread in the order the records
+ * were submitted. With no worker thread, records are verified on submission.
+ */
+class VerificationPool
+{
+public:
+  /**
+   * Verify a batch of records, one result per record in the same order.
+   */
+  using VerifyFunction = std::function<std::vector<VerificationResult>(const std::vector<shared_ptr<const Data>>&)>;
+  using DoneCallback = std::function<void(const VerificationResult&)>;
+
+  /**
+   * @param verify called on the worker threads, it must be safe to call concurrently
+   */
+  VerificationPool(boost::asio::io_service& ioService, size_t nThreads, const VerifyFunction& verify);
+
+  ~VerificationPool();
+
+  VerificationPool(const VerificationPool&) = delete;
+
+  VerificationPool&
+  operator=(const VerificationPool&) = delete;
+
+  /**
+   * Verify a record, @p done is called on the io_service thread.
+   */
+  void
+  verify(const shared_ptr<const Data>& data, const DoneCallback& done);
+
+  size_t
+  getNumThreads() const
+  {
+    return m_nThreads;
+  }
+
+  /**
+   * The maximum number of records a worker verifies at once.
+   */
+  static const size_t MAX_BATCH_SIZE;
+
+private:
+  struct Job
+  {
+    uint64_t sequence;
+    shared_ptr<const Data> data;
+  };
+
+  void
+  runWorker();
+
+  /**
+   * Call the callbacks of the finished jobs that all earlier jobs are delivered.
+   */
+  void
+  deliverResults();
+
+private:
+  boost::asio::io_service& m_ioService;
+  VerifyFunction m_verify;
+  const size_t m_nThreads;
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_mutex;
+  std::condition_variable m_jobAvailable;
+  std::deque<Job> m_jobs;
+  std::map<uint64_t, VerificationResult> m_results; // finished, not delivered
+  bool m_isStopped = false;
+
+  // accessed on the io_service thread only
+  uint64_t m_nextSequence = 0;
+  uint64_t m_nextToDeliver = 0;
+  std::map<uint64_t, DoneCallback> m_callbacks;
+  shared_ptr<bool> m_isAlive;
+};
+
+} // namespace dledger
+
+#endif // DLEDGER_SRC_VERIFICATION_POOL_H_
@@ -2,6 +2,7 @@
 #include <ndn-cxx/name.hpp>
 #include <iostream>
 #include <ndn-cxx/security/signature-sha256-with-rsa.hpp>
+#include <ndn-cxx/util/sha256.hpp>
 
 using namespace dledger;
 
@@ -67,6 +68,46 @@ testBackEndList() {
     return true;
 }
 
+bool
+testBlobStore()
+{
+    Backend backend("/tmp/test-blob.leveldb");
+    std::string content(20000, 'b');
+    auto digest = ndn::util::Sha256::computeDigest((const uint8_t*)content.data(), content.size());
+    while (backend.hasBlob(*digest)) {
+        backend.removeBlobReference(*digest);
+    }
+    backend.putRecord(makeData("/dledger/blob-test", "content"));
+
+    if (!backend.putBlob(*digest, (const uint8_t*)content.data(), content.size()) || !backend.hasBlob(*digest)) {
+        return false;
+    }
+    size_t referencesAfterFirstAdd = backend.addBlobReference(*digest);
+    size_t referencesAfterSecondAdd = backend.addBlobReference(*digest);
+    if (referencesAfterFirstAdd != 1 || referencesAfterSecondAdd != 2) {
+        return false;
+    }
+    auto blob = backend.getBlob(*digest);
+    if (blob == nullptr || std::string(blob->begin(), blob->end()) != content) {
+        return false;
+    }
+    // the blobs are not listed as records
+    if (backend.listRecord(Name("/")).size() != 1) {
+        return false;
+    }
+
+    // the blob is kept until its last reference is removed
+    size_t referencesAfterFirstRemove = backend.removeBlobReference(*digest);
+    if (referencesAfterFirstRemove != 1 || !backend.hasBlob(*digest)) {
+        return false;
+    }
+    size_t referencesAfterSecondRemove = backend.removeBlobReference(*digest);
+    if (referencesAfterSecondRemove != 0) {
+        return false;
+    }
+    return !backend.hasBlob(*digest) && backend.getBlob(*digest) == nullptr;
+}
+
 bool
 testNameGet()
 {
@@ -95,6 +136,13 @@ main(int argc, char** argv)
   else {
     std::cout << "testBackEndList with no errors" << std::endl;
   }
+  success = testBlobStore();
+  if (!success) {
+    std::cout << "testBlobStore failed" << std::endl;
+  }
+  else {
+    std::cout << "testBlobStore with no errors" << std::endl;
+  }
   success = testNameGet();
   if (!success) {
     std::cout << "testNameGet failed" << std::endl;
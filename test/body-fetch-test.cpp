@@ -0,0 +1,226 @@
+#include "backend.hpp"
+#include "default-cert-manager.h"
+#include "record_name.hpp"
+#include "dledger/record.hpp"
+#include "dledger/ledger.hpp"
+#include "test-helpers.hpp"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sys/stat.h>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/lp/nack.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/scheduler.hpp>
+#include <boost/asio/io_service.hpp>
+
+using namespace dledger;
+
+// A peer catches up with records whose bodies are carried by segments, served by the test itself.
+// The first Interest for one body segment is Nacked: the peer must fetch it again and still get the body.
+
+const std::string anchorName = "/dledger";
+const std::string multicastPrefix = "/dledger-multicast";
+const size_t producerNum = 4;
+const size_t recordsPerProducer = 2;
+const size_t payloadSize = 20000;
+
+bool
+testLostBodySegment(bool headerFirstSync)
+{
+  security::KeyChain keychain("pib-memory:", "tpm-memory:");
+  auto anchorIdentity = keychain.createIdentity(anchorName, EcKeyParams());
+  auto anchorCert = make_shared<security::Certificate>(anchorIdentity.getDefaultKey().getDefaultCertificate());
+  std::list<security::Certificate> producerCerts;
+  std::vector<Name> producerPrefixes;
+  for (size_t i = 0; i < producerNum; i++) {
+    producerPrefixes.emplace_back(anchorName + "/test-" + std::to_string(i));
+    producerCerts.push_back(issueCertificate(keychain, producerPrefixes.back(), anchorName, "test-anchor"));
+  }
+  Name clientPrefix(anchorName + "/test-client");
+  keychain.createIdentity(clientPrefix, EcKeyParams());
+
+  // the records and their body segments by full name
+  std::map<Name, shared_ptr<Data>> packets;
+  Config generatorConfig(multicastPrefix, anchorName, nullptr);
+  auto tips = generateDag(keychain, generatorConfig, producerPrefixes, producerNum * recordsPerProducer, payloadSize,
+                          [&packets] (const shared_ptr<Data>& packet) { packets[packet->getFullName()] = packet; });
+  // a body segment of the first tip
+  Name lostSegment;
+  for (const auto& packet : packets) {
+    if (packet.first.getPrefix(-2) == tips.front().getPrefix(-1)) {
+      lostSegment = packet.first;
+      break;
+    }
+  }
+
+  boost::asio::io_service ioService;
+  util::DummyClientFace face(ioService, keychain, util::DummyClientFace::Options(false, true));
+  Config config(multicastPrefix, clientPrefix.toUri(),
+                make_shared<DefaultCertificateManager>(clientPrefix, anchorCert, producerCerts));
+  config.databasePath = "/tmp/dledger-test/body-fetch-" +
+                        std::to_string(time::system_clock::now().time_since_epoch().count());
+  config.batchFetchDepth = 0;
+  config.headerFirstSync = headerFirstSync;
+  auto ledger = Ledger::initLedger(config, keychain, face);
+
+  // the test answers the Interests of the peer
+  size_t lostSegmentInterests = 0;
+  face.onSendInterest.connect([&] (const Interest& interest) {
+    auto packet = packets.find(interest.getName());
+    if (packet == packets.end()) {
+      return;
+    }
+    if (packet->first == lostSegment && lostSegmentInterests++ == 0) {
+      lp::Nack nack(interest);
+      nack.setReason(lp::NackReason::NO_ROUTE);
+      ioService.post([&face, nack] { face.receive(nack); });
+      return;
+    }
+    auto data = packet->second;
+    ioService.post([&face, data] { face.receive(*data); });
+  });
+
+  // a producer announces the tips of the DAG
+  Name syncInterestName(multicastPrefix);
+  syncInterestName.append("SYNC");
+  Interest syncInterest(syncInterestName);
+  Block appParam = makeEmptyBlock(tlv::ApplicationParameters);
+  for (const auto& tip : tips) {
+    appParam.push_back(tip.wireEncode());
+  }
+  appParam.parse();
+  syncInterest.setApplicationParameters(appParam);
+  syncInterest.setCanBePrefix(false);
+  syncInterest.setMustBeFresh(true);
+  keychain.sign(syncInterest, security::signingByIdentity(Name(anchorName + "/test-0")));
+
+  // done once every tip is in the ledger with its body
+  bool done = false;
+  auto start = time::steady_clock::now();
+  Scheduler scheduler(ioService);
+  std::function<void()> checkDone = [&] {
+    done = std::all_of(tips.begin(), tips.end(), [&] (const Name& tip) {
+      auto record = ledger->getRecord(tip.toUri());
+      return record && record->getRecordItems().size() == 1 &&
+             record->getRecordItems().front().value_size() == payloadSize;
+    });
+    if (done || time::steady_clock::now() - start > time::seconds(30)) {
+      ioService.stop();
+      return;
+    }
+    scheduler.schedule(time::milliseconds(10), checkDone);
+  };
+  scheduler.schedule(time::milliseconds(100), [&] { face.receive(syncInterest); });
+  scheduler.schedule(time::milliseconds(10), checkDone);
+  ioService.run();
+  return done && lostSegmentInterests >= 2;
+}
+
+// A peer is asked for the items of its stored records. The full name of a body segment followed by
+// /ITEM/<index> looks like an item name too, but it is not a record: the request must be ignored.
+bool
+testItemRequest()
+{
+  security::KeyChain keychain("pib-memory:", "tpm-memory:");
+  auto anchorIdentity = keychain.createIdentity(anchorName, EcKeyParams());
+  auto anchorCert = make_shared<security::Certificate>(anchorIdentity.getDefaultKey().getDefaultCertificate());
+  Name peerPrefix(anchorName + "/test-peer");
+  keychain.createIdentity(peerPrefix, EcKeyParams());
+  Config config(multicastPrefix, peerPrefix.toUri(),
+                make_shared<DefaultCertificateManager>(peerPrefix, anchorCert, std::list<security::Certificate>()));
+  config.databasePath = "/tmp/dledger-test/item-request-" +
+                        std::to_string(time::system_clock::now().time_since_epoch().count());
+
+  // a record of the peer with an item tree and a body in segments
+  Record record(RecordType::GENERIC_RECORD, "items");
+  std::vector<uint8_t> payload(payloadSize / 2, 0xAB);
+  record.addRecordItem(makeBinaryBlock(255, payload.data(), payload.size()));
+  record.addRecordItem(makeBinaryBlock(255, payload.data(), payload.size()));
+  record.addItemTree();
+  RecordName dataName(peerPrefix, record.getType(), record.getUniqueIdentifier());
+  auto bodySegments = record.makeBodySegments(dataName);
+  for (const auto& segment : bodySegments) {
+    keychain.sign(*segment, signingWithSha256());
+  }
+  record.setBodySegments(bodySegments);
+  auto data = make_shared<Data>(dataName);
+  data->setContent(record.wireEncode());
+  keychain.sign(*data, security::signingByIdentity(peerPrefix));
+  {
+    Backend backend(config.databasePath);
+    backend.putRecord(data);
+    for (const auto& segment : bodySegments) {
+      backend.putRecord(segment);
+    }
+  }
+  if (bodySegments.empty()) {
+    return false;
+  }
+
+  boost::asio::io_service ioService;
+  // the sent Data are logged
+  util::DummyClientFace face(ioService, keychain, util::DummyClientFace::Options(true, true));
+  auto ledger = Ledger::initLedger(config, keychain, face);
+  ioService.poll();
+
+  Name segmentItemName = ItemProof::makeItemName(bodySegments.front()->getFullName(), 0);
+  Name recordItemName = ItemProof::makeItemName(data->getFullName(), 1);
+  for (const auto& name : {segmentItemName, recordItemName}) {
+    Interest interest(name);
+    interest.setCanBePrefix(false);
+    face.receive(interest);
+  }
+  try {
+    ioService.poll();
+  }
+  catch (const std::exception& e) {
+    return false;
+  }
+
+  // only the item of the record is served
+  size_t recordItems = 0;
+  for (const auto& sentData : face.sentData) {
+    if (sentData.getName() == segmentItemName) {
+      return false;
+    }
+    if (sentData.getName() == recordItemName) {
+      recordItems++;
+    }
+  }
+  return recordItems == 1;
+}
+
+int
+main(int argc, char** argv)
+{
+  mkdir("/tmp/dledger-test/", S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+  // the ledger is very verbose
+  auto coutBuffer = std::cout.rdbuf(nullptr);
+  bool headerFirst = testLostBodySegment(true);
+  bool waitingForBody = testLostBodySegment(false);
+  bool itemRequest = testItemRequest();
+  std::cout.rdbuf(coutBuffer);
+
+  if (!headerFirst) {
+    std::cout << "testLostBodySegment with header-first sync failed" << std::endl;
+  }
+  else {
+    std::cout << "testLostBodySegment with header-first sync with no errors" << std::endl;
+  }
+  if (!waitingForBody) {
+    std::cout << "testLostBodySegment waiting for the body failed" << std::endl;
+  }
+  else {
+    std::cout << "testLostBodySegment waiting for the body with no errors" << std::endl;
+  }
+  if (!itemRequest) {
+    std::cout << "testItemRequest failed" << std::endl;
+  }
+  else {
+    std::cout << "testItemRequest with no errors" << std::endl;
+  }
+  return headerFirst && waitingForBody && itemRequest ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#include "backend.hpp"
+#include "default-cert-manager.h"
+#include "record_name.hpp"
+#include "dledger/record.hpp"
+#include "dledger/ledger.hpp"
+#include "test-helpers.hpp"
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <sys/stat.h>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/scheduler.hpp>
+#include <boost/asio/io_service.hpp>
+
+using namespace dledger;
+
+// Catch-up benchmark: a fresh peer fetches a pre-generated DAG from a peer holding it.
+// The serving peer uses "/dledger" as its prefix so that it answers for every producer.
+// Reports the wall time, the CPU time and the heap allocations of both peers.
+// The DAG is generated twice: with small records, and with payloads carried by body segments,
+// which a header-first peer fetches in the background.
+// Usage: catchup-bench [DAG depth...]
+//   the DAG depth is the number of records of each producer
+
+static std::atomic<size_t> allocationCount(0);
+
+void*
+operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+const std::string anchorName = "/dledger";
+const std::string multicastPrefix = "/dledger-multicast";
+const size_t producerNum = 4;
+const size_t largePayloadSize = 64 * 1024;
+
+class DiscardBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct CatchUpResult
+{
+    long elapsed = -1; // wall time in milliseconds, -1 on timeout
+    long cpuTime = 0; // in milliseconds
+    size_t allocations = 0;
+};
+
+CatchUpResult
+runCatchUp(security::KeyChain& keychain, const std::string& serverDb, const std::string& label,
+           size_t batchFetchDepth, size_t prefetchDepth, bool headerFirstSync,
+           shared_ptr<security::Certificate> anchorCert,
+           const std::list<security::Certificate>& producerCerts, const std::vector<Name>& tips)
+{
+    boost::asio::io_service ioService;
+    util::DummyClientFace serverFace(ioService, keychain, util::DummyClientFace::Options(false, true));
+    util::DummyClientFace clientFace(ioService, keychain, util::DummyClientFace::Options(false, true));
+    clientFace.linkTo(serverFace);
+
+    Config serverConfig(multicastPrefix, anchorName,
+                        make_shared<DefaultCertificateManager>(anchorName, anchorCert, producerCerts));
+    serverConfig.databasePath = serverDb;
+    auto server = Ledger::initLedger(serverConfig, keychain, serverFace);
+
+    Name clientPrefix(anchorName + "/bench-client");
+    Config clientConfig(multicastPrefix, clientPrefix.toUri(),
+                        make_shared<DefaultCertificateManager>(clientPrefix, anchorCert, producerCerts));
+    clientConfig.databasePath = "/tmp/dledger-bench/client-" + label + "-" +
+                                std::to_string(time::system_clock::now().time_since_epoch().count());
+    clientConfig.ancestorFetchTimeout = time::hours(1);
+    clientConfig.batchFetchDepth = batchFetchDepth;
+    clientConfig.prefetchDepth = prefetchDepth;
+    clientConfig.headerFirstSync = headerFirstSync;
+    auto client = Ledger::initLedger(clientConfig, keychain, clientFace);
+
+    // a producer announces the tips of the DAG
+    Name syncInterestName(multicastPrefix);
+    syncInterestName.append("SYNC");
+    Interest syncInterest(syncInterestName);
+    Block appParam = makeEmptyBlock(tlv::ApplicationParameters);
+    for (const auto& tip : tips) {
+        appParam.push_back(tip.wireEncode());
+    }
+    appParam.parse();
+    syncInterest.setApplicationParameters(appParam);
+    syncInterest.setCanBePrefix(false);
+    syncInterest.setMustBeFresh(true);
+    keychain.sign(syncInterest, security::signingByIdentity(Name(anchorName + "/bench-0")));
+
+    CatchUpResult result;
+    auto start = std::chrono::steady_clock::now();
+    std::clock_t cpuStart = std::clock();
+    size_t allocationStart = allocationCount.load();
+    Scheduler scheduler(ioService);
+    std::function<void()> checkDone = [&] {
+        bool done = std::all_of(tips.begin(), tips.end(), [&] (const Name& tip) {
+            return client->hasRecord(tip.toUri());
+        });
+        auto now = std::chrono::steady_clock::now();
+        if (done) {
+            result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+            result.cpuTime = (std::clock() - cpuStart) * 1000 / CLOCKS_PER_SEC;
+            result.allocations = allocationCount.load() - allocationStart;
+        }
+        if (done || now - start > std::chrono::minutes(30)) {
+            ioService.stop();
+            return;
+        }
+        scheduler.schedule(time::milliseconds(5), checkDone);
+    };
+    serverFace.expressInterest(syncInterest, nullptr, nullptr, nullptr);
+    scheduler.schedule(time::milliseconds(5), checkDone);
+    ioService.run();
+    return result;
+}
+
+int
+main(int argc, char** argv)
+{
+    std::vector<size_t> depths;
+    for (int i = 1; i < argc; i++) {
+        depths.push_back(std::stoul(argv[i]));
+    }
+    if (depths.empty()) {
+        depths = {250, 1000, 2500};
+    }
+    mkdir("/tmp/dledger-bench/", S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    security::KeyChain keychain("pib-memory:", "tpm-memory:");
+
+    auto anchorIdentity = keychain.createIdentity(anchorName, EcKeyParams());
+    auto anchorCert = make_shared<security::Certificate>(anchorIdentity.getDefaultKey().getDefaultCertificate());
+    std::list<security::Certificate> producerCerts;
+    std::vector<Name> producerPrefixes;
+    for (size_t i = 0; i < producerNum; i++) {
+        producerPrefixes.emplace_back(anchorName + "/bench-" + std::to_string(i));
+        producerCerts.push_back(issueCertificate(keychain, producerPrefixes.back(), anchorName, "bench-anchor"));
+    }
+    keychain.createIdentity(Name(anchorName + "/bench-client"), EcKeyParams());
+
+    // the ledgers are very verbose
+    DiscardBuffer discardBuffer;
+    auto coutBuffer = std::cout.rdbuf(&discardBuffer);
+
+    // name, batch depth, walk-ahead depth, header-first
+    using Mode = std::tuple<std::string, size_t, size_t, bool>;
+    std::vector<Mode> modes = {
+        {"per-record", 0, 0, true}, {"batch-16", 16, 0, true}, {"batch-64", 64, 0, true},
+        {"walk-ahead-16", 16, 4, true}};
+    std::vector<Mode> largePayloadModes = {
+        {"full-records", 16, 4, false}, {"header-first", 16, 4, true}};
+    auto runModes = [&] (const std::vector<Mode>& dagModes, size_t payloadSize) {
+        std::vector<std::vector<CatchUpResult>> results;
+        for (auto depth : depths) {
+            std::string serverDb = "/tmp/dledger-bench/server-" +
+                                   std::to_string(time::system_clock::now().time_since_epoch().count());
+            Config generatorConfig(multicastPrefix, anchorName, nullptr);
+            std::vector<Name> tips;
+            {
+                Backend backend(serverDb);
+                tips = generateDag(keychain, generatorConfig, producerPrefixes, depth * producerNum, payloadSize,
+                                   [&backend] (const shared_ptr<Data>& packet) { backend.putRecord(packet); });
+            }
+
+            results.emplace_back();
+            for (const auto& mode : dagModes) {
+                results.back().push_back(runCatchUp(keychain, serverDb, std::get<0>(mode), std::get<1>(mode),
+                                                    std::get<2>(mode), std::get<3>(mode),
+                                                    anchorCert, producerCerts, tips));
+            }
+        }
+        return results;
+    };
+    auto results = runModes(modes, 0);
+    auto largePayloadResults = runModes(largePayloadModes, largePayloadSize);
+    std::cout.rdbuf(coutBuffer);
+
+    // the time until the DAG is complete, the bodies of a header-first peer may still be in flight
+    auto printTable = [&] (const std::string& title, const std::vector<Mode>& tableModes,
+                           const std::vector<std::vector<CatchUpResult>>& tableResults,
+                           const std::function<double(const CatchUpResult&, size_t)>& value) {
+        std::cout << title << " by DAG depth (" << producerNum << " producers)" << std::endl;
+        std::cout << "depth\trecords";
+        for (const auto& mode : tableModes) {
+            std::cout << "\t" << std::get<0>(mode);
+        }
+        std::cout << std::endl;
+        for (size_t i = 0; i < depths.size(); i++) {
+            size_t recordNum = depths[i] * producerNum;
+            std::cout << depths[i] << "\t" << recordNum;
+            for (const auto& result : tableResults[i]) {
+                std::cout << "\t";
+                if (result.elapsed < 0) std::cout << "timeout";
+                else std::cout << value(result, recordNum);
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    };
+    auto printTables = [&] (const std::string& dagName, const std::vector<Mode>& tableModes,
+                            const std::vector<std::vector<CatchUpResult>>& tableResults) {
+        printTable("Catch-up time in ms" + dagName, tableModes, tableResults, [] (const CatchUpResult& result, size_t) {
+            return result.elapsed;
+        });
+        printTable("CPU time in ms" + dagName, tableModes, tableResults, [] (const CatchUpResult& result, size_t) {
+            return result.cpuTime;
+        });
+        printTable("Heap allocations per record" + dagName, tableModes, tableResults,
+                   [] (const CatchUpResult& result, size_t recordNum) {
+            return static_cast<long>(result.allocations / recordNum);
+        });
+    };
+    printTables("", modes, results);
+    printTables(" with " + std::to_string(largePayloadSize / 1024) + " KiB payloads", largePayloadModes,
+                largePayloadResults);
+    return 0;
+}
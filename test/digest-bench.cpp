@@ -0,0 +1,86 @@
+#include "record-batch.hpp"
+#include "record_name.hpp"
+#include "sha256-batch.hpp"
+#include "dledger/record.hpp"
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+using namespace dledger;
+
+// Implicit digest of received records: per packet through ndn-cxx against the batch kernels.
+// Usage: digest-bench [number of records]
+
+const size_t rounds = 20;
+
+double
+measure(size_t recordNum, const std::function<void()>& digestAll)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        digestAll();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (rounds * recordNum);
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t recordNum = argc > 1 ? std::stoul(argv[1]) : 4096;
+    security::KeyChain keychain("pib-memory:", "tpm-memory:");
+
+    // records as decoded from a batch, without a cached full name
+    std::vector<Block> wires;
+    for (size_t i = 0; i < recordNum; i++) {
+        Record record(RecordType::GENERIC_RECORD, std::to_string(i));
+        record.addRecordItem(makeStringBlock(255, std::string(200 + i % 300, 'x')));
+        Data data(RecordName(Name("/dledger/bench-" + std::to_string(i % 4)), record.getType(),
+                             record.getUniqueIdentifier(), time::system_clock::now()));
+        data.setContent(record.wireEncode());
+        keychain.sign(data, signingWithSha256());
+        wires.push_back(data.wireEncode());
+    }
+    auto decode = [&wires] {
+        std::vector<shared_ptr<Data>> records;
+        records.reserve(wires.size());
+        for (const auto& wire : wires) {
+            records.push_back(make_shared<Data>(wire));
+        }
+        return records;
+    };
+    auto records = decode();
+    std::vector<DigestInput> inputs;
+    for (const auto& wire : wires) {
+        inputs.push_back(DigestInput{wire.wire(), wire.size()});
+    }
+
+    // a decoded Data computes its full name once, so each round decodes the records again
+    double decodeTime = measure(recordNum, [&] { records = decode(); });
+    double perPacket = measure(recordNum, [&] {
+        records = decode();
+        for (const auto& record : records) {
+            record->getFullName();
+        }
+    }) - decodeTime;
+    double batch = measure(recordNum, [&] { RecordBatch::computeFullNames(records); });
+
+    std::cout << "Full name of " << recordNum << " records in microseconds per record" << std::endl;
+    std::cout << "per packet, Data::getFullName\t" << perPacket << std::endl;
+    std::cout << "batch, RecordBatch::computeFullNames\t" << batch << std::endl;
+    std::cout << std::endl << "SHA-256 kernels" << std::endl;
+    std::vector<std::pair<std::string, Sha256Kernel>> kernels = {
+        {"portable", Sha256Kernel::PORTABLE}, {"SHA-NI", Sha256Kernel::SHA_NI},
+        {"AVX2 multi-buffer", Sha256Kernel::AVX2_MULTI_BUFFER}};
+    for (const auto& kernel : kernels) {
+        std::cout << kernel.first << "\t";
+        if (!isSha256KernelSupported(kernel.second)) {
+            std::cout << "not supported" << std::endl;
+            continue;
+        }
+        std::cout << measure(recordNum, [&] { computeSha256Batch(inputs, kernel.second); }) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "default-cert-manager.h"
+#include "record_name.hpp"
+#include "dledger/record.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/security/verification-helpers.hpp>
+
+using namespace dledger;
+
+// Onboarding of many peers at once through certificate records, as received from the anchor.
+// Usage: onboarding-bench [number of peers] [certificates per record]
+
+const std::string anchorName = "/dledger";
+
+using Clock = std::chrono::steady_clock;
+
+double
+millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t peerNum = argc > 1 ? std::stoul(argv[1]) : 10000;
+    size_t certsPerRecord = argc > 2 ? std::stoul(argv[2]) : 4000;
+    security::KeyChain keychain("pib-memory:", "tpm-memory:");
+    auto anchorIdentity = keychain.createIdentity(anchorName, EcKeyParams());
+    auto anchorCert = make_shared<security::Certificate>(anchorIdentity.getDefaultKey().getDefaultCertificate());
+    auto anchorSigning = security::signingByKey(anchorIdentity.getDefaultKey());
+
+    // the peers share one key pair, only their certificates matter here
+    auto peerKey = keychain.createIdentity(anchorName + "/bench-key", EcKeyParams()).getDefaultKey();
+    SignatureInfo signatureInfo;
+    signatureInfo.setValidityPeriod(security::ValidityPeriod(time::system_clock::now() - time::days(1),
+                                                             time::system_clock::now() + time::days(365)));
+    anchorSigning.setSignatureInfo(signatureInfo);
+
+    std::vector<Block> recordWires;
+    for (size_t first = 0; first < peerNum; first += certsPerRecord) {
+        CertificateRecord record("onboarding-" + std::to_string(first));
+        for (size_t i = first; i < std::min(peerNum, first + certsPerRecord); i++) {
+            security::Certificate cert;
+            Name certName(anchorName + "/peer-" + std::to_string(i));
+            certName.append("KEY").append(peerKey.getName().get(-1)).append("anchor").appendVersion();
+            cert.setName(certName);
+            cert.setContent(peerKey.getPublicKey().data(), peerKey.getPublicKey().size());
+            keychain.sign(cert, anchorSigning);
+            record.addCertificateItem(cert);
+        }
+        // the body is kept in the record packet, not split into segments
+        Data data(RecordName(Name(anchorName), record.getType(), record.getUniqueIdentifier(),
+                             time::system_clock::now()));
+        data.setContent(record.wireEncode());
+        keychain.sign(data, security::signingByKey(anchorIdentity.getDefaultKey()));
+        recordWires.push_back(data.wireEncode());
+    }
+
+    // each certificate parsed and verified with the anchor certificate one after the other
+    auto start = Clock::now();
+    for (const auto& wire : recordWires) {
+        CertificateRecord record{Record(make_shared<Data>(wire))};
+        for (const auto& cert : record.getCertificates()) {
+            if (!security::verifySignature(cert, *anchorCert)) {
+                std::cerr << "Bad certificate" << std::endl;
+            }
+        }
+    }
+    double sequentialTime = millisecondsSince(start);
+
+    DefaultCertificateManager certificateManager(anchorName, anchorCert, {});
+    std::vector<Record> records;
+    start = Clock::now();
+    for (const auto& wire : recordWires) {
+        records.emplace_back(make_shared<Data>(wire));
+    }
+    double decodeTime = millisecondsSince(start);
+    start = Clock::now();
+    for (const auto& record : records) {
+        if (!certificateManager.verifyRecordFormat(record)) {
+            std::cerr << "Bad certificate record" << std::endl;
+        }
+    }
+    double formatTime = millisecondsSince(start);
+    start = Clock::now();
+    for (const auto& record : records) {
+        certificateManager.acceptRecord(record);
+    }
+    double acceptTime = millisecondsSince(start);
+
+    std::cout << "Onboarding of " << peerNum << " peers in " << recordWires.size() << " certificate records, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << "step\tms\tmicroseconds per peer" << std::endl;
+    std::cout << "parse and verify one by one\t" << sequentialTime << "\t" << sequentialTime * 1000 / peerNum
+              << std::endl;
+    std::cout << "decode records\t" << decodeTime << "\t" << decodeTime * 1000 / peerNum << std::endl;
+    std::cout << "verifyRecordFormat\t" << formatTime << "\t" << formatTime * 1000 / peerNum << std::endl;
+    std::cout << "acceptRecord\t" << acceptTime << "\t" << acceptTime * 1000 / peerNum << std::endl;
+    double total = decodeTime + formatTime + acceptTime;
+    std::cout << "total\t" << total << "\t" << total * 1000 / peerNum << std::endl;
+    return 0;
+}
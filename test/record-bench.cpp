@@ -0,0 +1,211 @@
+#include "record_name.hpp"
+#include "dledger/record.hpp"
+#include "dledger/typed-record.hpp"
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/util/sha256.hpp>
+
+using namespace dledger;
+
+// Record encoding: appending the items to blocks one by one against the estimated size encoding,
+// record decoding by the parts of the record used, and reading a payload of three integers from
+// string items against a typed schema.
+// Reports the time and the heap allocations per record by record shape.
+// Usage: record-bench [number of rounds]
+
+static std::atomic<size_t> allocationCount(0);
+
+void*
+operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// the TLV types of Record
+const uint32_t T_RecordHeader = 129;
+const uint32_t T_RecordContent = 130;
+const uint32_t T_BodyManifest = 131;
+
+// the encoding before the estimated size one, for comparison
+Block
+encodeByAppending(const Record& record, const std::vector<name::Component>& bodySegmentDigests)
+{
+    auto block = makeEmptyBlock(tlv::Content);
+    auto header = makeEmptyBlock(T_RecordHeader);
+    for (const auto& pointer : record.getPointersFromHeader()) {
+        header.push_back(pointer.wireEncode());
+    }
+    if (!bodySegmentDigests.empty()) {
+        auto manifest = makeEmptyBlock(T_BodyManifest);
+        for (const auto& digest : bodySegmentDigests) {
+            manifest.push_back(digest);
+        }
+        manifest.encode();
+        header.push_back(manifest);
+    }
+    header.parse();
+    block.push_back(header);
+    block.parse();
+    auto body = makeEmptyBlock(T_RecordContent);
+    if (bodySegmentDigests.empty()) {
+        for (const auto& item : record.getRecordItems()) {
+            body.push_back(item);
+        }
+    }
+    body.parse();
+    block.push_back(body);
+    block.parse();
+    block.encode();
+    return block;
+}
+
+struct Measurement
+{
+    double microseconds;
+    double allocations;
+};
+
+Measurement
+measure(size_t rounds, const std::function<void()>& encode)
+{
+    size_t allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        encode();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return Measurement{elapsed.count() / rounds, double(allocationCount.load() - allocationsBefore) / rounds};
+}
+
+Record
+makeRecord(size_t pointerNum, size_t itemNum, size_t itemSize)
+{
+    Record record(RecordType::GENERIC_RECORD, "bench");
+    for (size_t i = 0; i < pointerNum; i++) {
+        record.addPointer(Name("/dledger/bench-" + std::to_string(i) + "/1/" + std::to_string(i))
+                              .appendTimestamp()
+                              .appendImplicitSha256Digest(util::Sha256::computeDigest(nullptr, 0)));
+    }
+    for (size_t i = 0; i < itemNum; i++) {
+        record.addRecordItem(makeStringBlock(255, std::string(itemSize, 'x')));
+    }
+    return record;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t rounds = argc > 1 ? std::stoul(argv[1]) : 10000;
+    security::KeyChain keychain("pib-memory:", "tpm-memory:");
+    struct Shape
+    {
+        std::string description;
+        size_t pointerNum;
+        size_t itemNum;
+        size_t itemSize;
+        size_t segmentNum;
+    };
+    std::vector<Shape> shapes = {
+        {"3 pointers, 1 item of 100 B", 3, 1, 100, 0},
+        {"3 pointers, 20 items of 300 B", 3, 20, 300, 0},
+        {"3 pointers, 100 items of 60 B", 3, 100, 60, 0},
+        {"5 pointers, body in 240 segments", 5, 0, 0, 240},
+    };
+
+    std::cout << "Encoding of records, per record" << std::endl;
+    std::cout << "record\tappending (us)\tappending (allocations)\testimated (us)\testimated (allocations)"
+              << std::endl;
+    for (const auto& shape : shapes) {
+        auto record = makeRecord(shape.pointerNum, shape.itemNum, shape.itemSize);
+        std::vector<name::Component> digests;
+        std::vector<shared_ptr<Data>> segments;
+        for (size_t i = 0; i < shape.segmentNum; i++) {
+            auto segment = make_shared<Data>(Name("/dledger/bench/1/bench").appendSegment(i));
+            keychain.sign(*segment, signingWithSha256());
+            digests.push_back(segment->getFullName().get(-1));
+            segments.push_back(segment);
+        }
+        record.setBodySegments(segments);
+
+        if (encodeByAppending(record, digests) != record.wireEncode()) {
+            std::cerr << "Different encodings of " << shape.description << std::endl;
+            return 1;
+        }
+        auto appending = measure(rounds, [&] { encodeByAppending(record, digests); });
+        auto estimated = measure(rounds, [&] { record.wireEncode(); });
+        std::cout << shape.description << "\t" << appending.microseconds << "\t" << appending.allocations << "\t"
+                  << estimated.microseconds << "\t" << estimated.allocations << std::endl;
+    }
+
+    // the header and the body are decoded when first used
+    std::cout << std::endl << "Decoding of records, per record" << std::endl;
+    std::cout << "record	type (us)	type (allocations)	pointers (us)	pointers (allocations)"
+              << "	pointers and items (us)	pointers and items (allocations)" << std::endl;
+    for (const auto& shape : shapes) {
+        if (shape.segmentNum != 0) continue;
+        auto record = makeRecord(shape.pointerNum, shape.itemNum, shape.itemSize);
+        auto data = make_shared<Data>(RecordName(Name("/dledger/bench-0"), record.getType(),
+                                                 record.getUniqueIdentifier(), time::system_clock::now()));
+        data->setContent(record.wireEncode());
+        keychain.sign(*data, signingWithSha256());
+        data->wireEncode();
+        auto typeOnly = measure(rounds, [&] { Record(data).getType(); });
+        auto pointers = measure(rounds, [&] { Record(data).getPointersFromHeader(); });
+        auto all = measure(rounds, [&] {
+            Record decoded(data);
+            decoded.getPointersFromHeader();
+            decoded.getRecordItems();
+        });
+        std::cout << shape.description << "\t" << typeOnly.microseconds << "\t" << typeOnly.allocations << "\t"
+                  << pointers.microseconds << "\t" << pointers.allocations << "\t" << all.microseconds << "\t"
+                  << all.allocations << std::endl;
+    }
+
+    using Payload = RecordSchema<254, IntegerField<1, int32_t>, IntegerField<2, int32_t>, IntegerField<3, int32_t>>;
+    Record stringRecord(RecordType::GENERIC_RECORD, "bench-string");
+    for (int value : {123456, 654321, 42}) {
+        stringRecord.addRecordItem(makeStringBlock(255, std::to_string(value)));
+    }
+    Record typedRecord(RecordType::GENERIC_RECORD, "bench-typed");
+    Payload::appendTo(typedRecord, std::make_tuple(123456, 654321, 42));
+    int32_t sum = 0;
+    auto stringRead = measure(rounds, [&] {
+        for (const auto& item : stringRecord.getRecordItems()) {
+            sum += std::stoi(readString(item));
+        }
+    });
+    auto typedRead = measure(rounds, [&] {
+        const Block* item = Payload::find(typedRecord);
+        sum += Payload::get<0>(*item) + Payload::get<1>(*item) + Payload::get<2>(*item);
+    });
+    std::cout << std::endl << "Reading three integers from a decoded record, per record" << std::endl;
+    std::cout << "payload\tus\tallocations" << std::endl;
+    std::cout << "string items\t" << stringRead.microseconds << "\t" << stringRead.allocations << std::endl;
+    std::cout << "typed schema\t" << typedRead.microseconds << "\t" << typedRead.allocations << std::endl;
+    if (sum == 0) {
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -1,13 +1,442 @@
 #include "dledger/record.hpp"
 #include "dledger/ledger.hpp"
+#include "dledger/typed-record.hpp"
+#include "record_name.hpp"
+#include "record-batch.hpp"
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/security/signature-sha256-with-rsa.hpp>
 #include <ndn-cxx/util/io.hpp>
 
 using namespace dledger;
 
+const Name producerPrefix("/dledger/test-producer");
+
+// the records are not verified here
+void
+signWithFakeSignature(Data& data)
+{
+  SignatureSha256WithRsa fakeSignature;
+  fakeSignature.setValue(encoding::makeEmptyBlock(tlv::SignatureValue));
+  data.setSignature(fakeSignature);
+  data.wireEncode();
+}
+
+shared_ptr<Data>
+makeRecordData(const Name& dataName, const Block& content)
+{
+  auto data = make_shared<Data>(dataName);
+  data->setContent(content);
+  signWithFakeSignature(*data);
+  return data;
+}
+
+shared_ptr<Data>
+makeRecordData(const Record& record)
+{
+  return makeRecordData(RecordName(producerPrefix, record.getType(), record.getUniqueIdentifier()),
+                        record.wireEncode());
+}
+
+bool
+testEncoding()
+{
+  Record record(GENERIC_RECORD, "encoding");
+  record.addPointer(Name("/dledger/a"));
+  record.addPointer(Name("/dledger/b"));
+  record.addRecordItem(makeStringBlock(255, "first"));
+  record.addRecordItem(makeStringBlock(255, "second"));
+  auto content = record.wireEncode();
+
+  // the deprecated overload appends the same elements
+  auto appended = makeEmptyBlock(tlv::Content);
+  record.wireEncode(appended);
+  appended.encode();
+  if (appended != content) {
+    return false;
+  }
+
+  Record received(makeRecordData(record));
+  const auto& pointers = received.getPointersFromHeader();
+  const auto& items = received.getRecordItems();
+  if (received.getType() != GENERIC_RECORD || received.getUniqueIdentifier() != "encoding" ||
+      received.getProducerPrefix() != producerPrefix) {
+    return false;
+  }
+  if (pointers.size() != 2 || pointers[0] != Name("/dledger/a") || pointers[1] != Name("/dledger/b")) {
+    return false;
+  }
+  if (items.size() != 2 || readString(items[0]) != "first" || readString(items[1]) != "second") {
+    return false;
+  }
+  // a decoded record is encoded again as it was received
+  return received.wireEncode() == content;
+}
+
+bool
+testLazyDecode()
+{
+  // a header item of an unknown type is well formed TLV, and only rejected when the header is read
+  auto header = makeEmptyBlock(129);
+  header.push_back(makeStringBlock(200, "unknown"));
+  header.encode();
+  auto content = makeEmptyBlock(tlv::Content);
+  content.push_back(header);
+  content.push_back(makeEmptyBlock(130));
+  content.encode();
+  auto data = makeRecordData(RecordName(producerPrefix, GENERIC_RECORD, "bad-header"), content);
+
+  shared_ptr<const Record> record;
+  try {
+    record = make_shared<Record>(data);
+  }
+  catch (const std::exception& e) {
+    return false;
+  }
+  // the failure is not cached as a decoded header
+  for (int i = 0; i < 2; i++) {
+    try {
+      record->getPointersFromHeader();
+      return false;
+    }
+    catch (const std::exception& e) {
+    }
+  }
+  // the body is decoded on its own
+  if (!record->getRecordItems().empty()) {
+    return false;
+  }
+
+  // a malformed TLV element is rejected when the record is decoded
+  const uint8_t truncated[] = {0x07, 0x05, 0x08};
+  auto badContent = makeEmptyBlock(tlv::Content);
+  badContent.push_back(makeBinaryBlock(129, truncated, sizeof(truncated)));
+  badContent.push_back(makeEmptyBlock(130));
+  badContent.encode();
+  try {
+    Record badRecord(makeRecordData(RecordName(producerPrefix, GENERIC_RECORD, "bad-element"), badContent));
+    return false;
+  }
+  catch (const std::exception& e) {
+  }
+  return true;
+}
+
+bool
+testConcurrentDecode()
+{
+  Record record(GENERIC_RECORD, "concurrent");
+  record.addPointer(Name("/dledger/a"));
+  for (int i = 0; i < 16; i++) {
+    record.addRecordItem(makeStringBlock(255, "item " + std::to_string(i)));
+  }
+  // several threads read the same const record, which is decoded on first access
+  auto shared = std::make_shared<const Record>(makeRecordData(record));
+  std::vector<std::thread> threads;
+  std::vector<int> results(8, 0);
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back([&shared, &results, i] {
+      results[i] = shared->getPointersFromHeader().size() == 1 && shared->getRecordItems().size() == 16;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return std::all_of(results.begin(), results.end(), [] (int result) { return result == 1; });
+}
+
+bool
+testMovedRecord()
+{
+  Record record(GENERIC_RECORD, "moved");
+  record.addPointer(Name("/dledger/a"));
+  record.addRecordItem(makeStringBlock(255, "payload"));
+  Record copy(record);
+  Record moved(std::move(record));
+  if (moved.getRecordItems().size() != 1 || readString(moved.getRecordItems()[0]) != "payload" ||
+      moved.getPointersFromHeader().size() != 1) {
+    return false;
+  }
+  // the copy keeps its own items
+  copy.addRecordItem(makeStringBlock(255, "another"));
+  if (moved.getRecordItems().size() != 1 || copy.getRecordItems().size() != 2) {
+    return false;
+  }
+
+  // the copies of a decoded record share its decoded contents, which a moved record takes along
+  Record received(makeRecordData(moved));
+  Record receivedCopy(received);
+  const Block* item = &received.getRecordItems()[0];
+  Record receivedMoved(std::move(received));
+  return &receivedCopy.getRecordItems()[0] == item && &receivedMoved.getRecordItems()[0] == item &&
+         readString(*item) == "payload" && receivedMoved.wireEncode() == moved.wireEncode();
+}
+
+bool
+testSegmentedBody()
+{
+  Record record(GENERIC_RECORD, "segmented");
+  record.addPointer(Name("/dledger/a"));
+  std::vector<uint8_t> payload(Record::BODY_SEGMENT_SIZE * 2, 0xAB);
+  record.addRecordItem(makeBinaryBlock(255, payload.data(), payload.size()));
+  RecordName dataName(producerPrefix, record.getType(), record.getUniqueIdentifier());
+  auto segments = record.makeBodySegments(dataName);
+  // two segments are not enough for the TLV headers around the payload
+  if (segments.size() != 3) {
+    return false;
+  }
+  std::vector<shared_ptr<const Data>> receivedSegments;
+  std::vector<Name> segmentNames;
+  for (const auto& segment : segments) {
+    signWithFakeSignature(*segment);
+    receivedSegments.push_back(segment);
+    segmentNames.push_back(segment->getFullName());
+  }
+  record.setBodySegments(segments);
+  auto content = record.wireEncode();
+  // the body is not in the record packet any more
+  if (content.size() >= Record::BODY_SEGMENT_SIZE) {
+    return false;
+  }
+
+  Record received(makeRecordData(dataName, content));
+  if (!received.hasSegmentedBody() || !received.getRecordItems().empty() ||
+      received.getBodySegmentNames() != segmentNames) {
+    return false;
+  }
+
+  // a segment whose digest does not match the manifest is rejected
+  std::vector<uint8_t> otherPayload(Record::BODY_SEGMENT_SIZE, 0xCD);
+  auto wrongSegment = make_shared<Data>(*segments[1]);
+  wrongSegment->setContent(otherPayload.data(), otherPayload.size());
+  signWithFakeSignature(*wrongSegment);
+  auto wrongSegments = receivedSegments;
+  wrongSegments[1] = wrongSegment;
+  try {
+    received.decodeBodySegments(wrongSegments);
+    return false;
+  }
+  catch (const std::exception& e) {
+  }
+  // so is a missing segment
+  try {
+    received.decodeBodySegments({receivedSegments[0], receivedSegments[1]});
+    return false;
+  }
+  catch (const std::exception& e) {
+  }
+
+  received.decodeBodySegments(receivedSegments);
+  const auto& items = received.getRecordItems();
+  return items.size() == 1 && items[0].value_size() == payload.size() &&
+         std::equal(payload.begin(), payload.end(), items[0].value()) &&
+         received.getPointersFromHeader().size() == 1;
+}
+
+Block
+tamperProof(const Block& proof)
+{
+  proof.parse();
+  auto tampered = makeEmptyBlock(ItemProof::T_ItemProof);
+  for (const auto& element : proof.elements()) {
+    if (element.type() != ItemProof::T_ProofNode) {
+      tampered.push_back(element);
+      continue;
+    }
+    Buffer node(element.value(), element.value_size());
+    node[0] ^= 1;
+    tampered.push_back(makeBinaryBlock(ItemProof::T_ProofNode, node.data(), node.size()));
+  }
+  tampered.encode();
+  return tampered;
+}
+
+bool
+testItemTree()
+{
+  // the last node of a level without a sibling moves up, so odd counts take other paths
+  for (size_t itemCount : {1, 2, 3, 5, 7}) {
+    Record record(GENERIC_RECORD, "item-tree-" + std::to_string(itemCount));
+    for (size_t i = 0; i < itemCount; i++) {
+      record.addRecordItem(makeStringBlock(255, "item " + std::to_string(i)));
+    }
+    record.addItemTree();
+    Record received(makeRecordData(record));
+    if (!received.hasItemTree()) {
+      return false;
+    }
+    received.checkItemTree();
+    const auto& items = received.getRecordItems();
+    auto root = ItemTree::computeRoot(items.data(), items.size());
+
+    for (size_t i = 0; i < itemCount; i++) {
+      ItemProof proof(ItemProof(items.data(), items.size(), i).wireEncode());
+      if (proof.getIndex() != i || !proof.verify(items[i], itemCount, *root)) {
+        return false;
+      }
+      // another item, or another tree size, does not match the proof
+      if ((itemCount > 1 && proof.verify(items[(i + 1) % itemCount], itemCount, *root)) ||
+          proof.verify(items[i], itemCount + 1, *root)) {
+        return false;
+      }
+      // an item served alone is checked against the header
+      auto itemData = received.makeItemData(i);
+      signWithFakeSignature(*itemData);
+      if (received.decodeItemData(*itemData) != items[i]) {
+        return false;
+      }
+    }
+
+    if (itemCount == 1) {
+      continue;
+    }
+    // a tampered path is rejected, alone and in the Data carrying the item
+    auto tampered = tamperProof(ItemProof(items.data(), items.size(), itemCount - 1).wireEncode());
+    if (ItemProof(tampered).verify(items[itemCount - 1], itemCount, *root)) {
+      return false;
+    }
+    auto content = makeEmptyBlock(tlv::Content);
+    content.push_back(items[itemCount - 1]);
+    content.push_back(tampered);
+    content.encode();
+    Data tamperedData(ItemProof::makeItemName(received.getRecordName(), itemCount - 1));
+    tamperedData.setContent(content);
+    signWithFakeSignature(tamperedData);
+    try {
+      received.decodeItemData(tamperedData);
+      return false;
+    }
+    catch (const std::exception& e) {
+    }
+  }
+  return true;
+}
+
+bool
+testRecordName()
+{
+  time::system_clock::TimePoint timestamp(time::seconds(1600000000));
+  RecordName recordName(producerPrefix, CERTIFICATE_RECORD, "cert", timestamp);
+  // the fields parsed from a name match the name given to the Data
+  Data data(recordName);
+  signWithFakeSignature(data);
+  RecordName parsed(data.getFullName());
+  if (parsed.getName() != data.getFullName() || !parsed.hasImplicitDigest() ||
+      parsed.getProducerPrefix() != producerPrefix || parsed.getRecordType() != CERTIFICATE_RECORD ||
+      parsed.getRecordUniqueIdentifier() != "cert" || parsed.getGenerationTimestamp() != timestamp) {
+    return false;
+  }
+  try {
+    RecordName notRecordName(Name("/dledger/a/b"));
+    return false;
+  }
+  catch (const std::exception& e) {
+  }
+  return true;
+}
+
+bool
+testBatchName()
+{
+  // the peer prefix may contain an ANCESTORS component too
+  Name peerPrefix("/dledger/ANCESTORS/peer");
+  std::vector<Name> roots = {Name("/dledger/a/GENERIC_RECORD/1"), Name("/dledger/b/GENERIC_RECORD/2")};
+  auto batchName = RecordBatch::makeBatchName(peerPrefix, 3, roots);
+  for (const auto& name : {batchName, Name(batchName).appendSegment(2)}) {
+    size_t depth = 0;
+    std::vector<Name> parsedRoots;
+    if (!RecordBatch::isBatchName(name) || !RecordBatch::parseBatchName(name, depth, parsedRoots) ||
+        depth != 3 || parsedRoots != roots || RecordBatch::getPeerPrefix(name) != peerPrefix) {
+      return false;
+    }
+  }
+
+  // ANCESTORS anywhere else is not a batch name
+  std::vector<Name> otherNames = {
+    Name("/dledger/ANCESTORS/GENERIC_RECORD/1"),
+    Name("/dledger/ANCESTORS").appendNumber(3),
+    Name("/dledger/ANCESTORS").appendNumber(3).append("not-a-name"),
+    Name(batchName).append("suffix"),
+  };
+  std::vector<Name> tooManyRoots(RecordBatch::MAX_ROOTS + 1, roots.front());
+  otherNames.push_back(RecordBatch::makeBatchName(peerPrefix, 3, tooManyRoots));
+  size_t depth = 0;
+  std::vector<Name> parsedRoots;
+  return std::none_of(otherNames.begin(), otherNames.end(), [&] (const Name& name) {
+    return RecordBatch::isBatchName(name) || RecordBatch::parseBatchName(name, depth, parsedRoots);
+  });
+}
+
+bool
+testRecordSchema()
+{
+  using Measurement = RecordSchema<200, IntegerField<1, int32_t>, BytesField<2, 4>>;
+  std::array<uint8_t, 4> sensor = {1, 2, 3, 4};
+  auto item = Measurement::encode(std::make_tuple(-42, sensor));
+  if (!Measurement::matches(item) || Measurement::get<0>(item) != -42 || Measurement::get<1>(item) != sensor) {
+    return false;
+  }
+
+  // an item of the same type and size whose field type or length differs
+  std::vector<Block> malformedItems;
+  for (size_t offset : {size_t(0), size_t(1), size_t(6), size_t(7)}) {
+    Buffer value(item.value(), item.value_size());
+    value[offset] ^= 0x10;
+    malformedItems.push_back(makeBinaryBlock(200, value.data(), value.size()));
+  }
+  // an item of another type or size
+  malformedItems.push_back(makeBinaryBlock(201, item.value(), item.value_size()));
+  malformedItems.push_back(makeBinaryBlock(200, item.value(), item.value_size() - 1));
+  malformedItems.push_back(makeEmptyBlock(200));
+  for (const auto& malformedItem : malformedItems) {
+    if (Measurement::matches(malformedItem)) {
+      return false;
+    }
+    try {
+      Measurement::decode(malformedItem);
+      return false;
+    }
+    catch (const tlv::Error& e) {
+    }
+  }
+
+  // the items which do not match are skipped
+  Record record(GENERIC_RECORD, "schema");
+  for (const auto& malformedItem : malformedItems) {
+    record.addRecordItem(malformedItem);
+  }
+  record.addRecordItem(item);
+  Record received(makeRecordData(record));
+  const Block* found = Measurement::find(received);
+  return found != nullptr && Measurement::decode(*found) == std::make_tuple(-42, sensor);
+}
+
+void
+report(const std::string& testName, bool success)
+{
+  if (!success) {
+    std::cout << testName << " failed" << std::endl;
+  }
+  else {
+    std::cout << testName << " with no errors" << std::endl;
+  }
+}
+
 int main(int argc, char const *argv[])
 {
+  report("testEncoding", testEncoding());
+  report("testLazyDecode", testLazyDecode());
+  report("testConcurrentDecode", testConcurrentDecode());
+  report("testMovedRecord", testMovedRecord());
+  report("testSegmentedBody", testSegmentedBody());
+  report("testItemTree", testItemTree());
+  report("testRecordName", testRecordName());
+  report("testBatchName", testBatchName());
+  report("testRecordSchema", testRecordSchema());
+
   std::shared_ptr<Config> config = nullptr;
   try {
     config = Config::DefaultConfig();
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <sys/stat.h>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+using namespace ndn;
+
+// Sign-path latency: resolving the identity on each call against a cached key.
+// The KeyChain is SQLite/file based, as used by the peers.
+// Usage: sign-bench [number of signatures]
+
+const std::string identityName = "/dledger/sign-bench";
+
+double
+measure(size_t count, const std::function<void()>& signOnce)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        signOnce();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / static_cast<double>(count);
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 2000;
+    std::string dir = "/tmp/dledger-sign-bench-" + std::to_string(time::system_clock::now().time_since_epoch().count());
+    mkdir(dir.c_str(), S_IRWXU);
+    security::KeyChain keychain("pib-sqlite3:" + dir, "tpm-file:" + dir + "/tpm");
+    auto identity = keychain.createIdentity(identityName, EcKeyParams());
+    auto cachedSigningInfo = security::signingByKey(identity.getDefaultKey());
+
+    Data data(Name(identityName).append("record"));
+    data.setContent(reinterpret_cast<const uint8_t*>("content"), 7);
+    Interest syncInterest(Name("/dledger-multicast/SYNC"));
+    syncInterest.setCanBePrefix(false);
+
+    auto byIdentityData = measure(count, [&] {
+        keychain.sign(data, security::signingByIdentity(Name(identityName)));
+    });
+    auto byKeyData = measure(count, [&] {
+        keychain.sign(data, cachedSigningInfo);
+    });
+    auto byIdentityInterest = measure(count, [&] {
+        Interest interest(syncInterest);
+        keychain.sign(interest, security::signingByIdentity(Name(identityName)));
+    });
+    keychain.sign(syncInterest, cachedSigningInfo);
+    auto reusedInterest = measure(count, [&] {
+        syncInterest.refreshNonce();
+        syncInterest.wireEncode();
+    });
+
+    std::cout << "Average latency of " << count << " calls in microseconds" << std::endl;
+    std::cout << "record, signing by identity\t" << byIdentityData << std::endl;
+    std::cout << "record, signing by cached key\t" << byKeyData << std::endl;
+    std::cout << "SYNC, signing by identity\t" << byIdentityInterest << std::endl;
+    std::cout << "SYNC, cached signed Interest\t" << reusedInterest << std::endl;
+    return 0;
+}
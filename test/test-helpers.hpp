@@ -0,0 +1,107 @@
+#ifndef DLEDGER_TEST_TEST_HELPERS_HPP
+#define DLEDGER_TEST_TEST_HELPERS_HPP
+
+#include "record_name.hpp"
+#include "dledger/config.hpp"
+#include "dledger/record.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+// The certificates and the record DAGs shared by the tests and the benchmarks.
+
+namespace dledger {
+
+/**
+ * Create an identity and issue its certificate, signed by the anchor identity and valid for a day around now.
+ * @p anchorComponent, input, the issuer component of the certificate name
+ */
+inline security::Certificate
+issueCertificate(security::KeyChain& keychain, const Name& identityName, const Name& anchorName,
+                 const std::string& anchorComponent)
+{
+  auto identity = keychain.createIdentity(identityName, EcKeyParams());
+  const auto& key = identity.getDefaultKey();
+  security::Certificate newCert;
+
+  Name certName = key.getName();
+  certName.append(anchorComponent).appendVersion();
+  newCert.setName(certName);
+  newCert.setContent(key.getPublicKey().data(), key.getPublicKey().size());
+  SignatureInfo signatureInfo;
+  signatureInfo.setValidityPeriod(security::ValidityPeriod(time::system_clock::now() - time::days(1),
+                                                           time::system_clock::now() + time::days(1)));
+  security::SigningInfo signingInfo(security::SigningInfo::SIGNER_TYPE_ID, anchorName, signatureInfo);
+  keychain.sign(newCert, signingInfo);
+  return newCert;
+}
+
+/**
+ * Get the full name of the genesis record @p i, the same on every peer.
+ */
+inline Name
+makeGenesisName(security::KeyChain& keychain, const Config& config, int i)
+{
+  GenesisRecord genesisRecord(std::to_string(i));
+  auto data = make_shared<Data>(RecordName::generateRecordName(config, genesisRecord));
+  data->setContent(genesisRecord.wireEncode());
+  keychain.sign(*data, signingWithSha256());
+  return data->getFullName();
+}
+
+/**
+ * Generate a DAG in which each record of a producer points to the latest records of the next two producers.
+ * The producers take turns, two seconds of generation time apart, ending ten seconds ago.
+ * @p producerPrefixes, input, the producers, whose identities sign their records
+ * @p payloadSize, input, 0 for a small item carrying the record number
+ * @p onPacket, input, called with each signed record and body segment
+ * @return the full names of the latest records of the producers
+ */
+inline std::vector<Name>
+generateDag(security::KeyChain& keychain, const Config& config, const std::vector<Name>& producerPrefixes,
+            size_t recordNum, size_t payloadSize, const std::function<void(const shared_ptr<Data>&)>& onPacket)
+{
+  size_t producerNum = producerPrefixes.size();
+  std::vector<uint8_t> payload(payloadSize, 0xAB);
+  std::vector<Name> latest;
+  for (size_t i = 0; i < producerNum; i++) {
+    latest.push_back(makeGenesisName(keychain, config, i));
+  }
+  auto start = time::system_clock::now() - time::seconds(2 * (recordNum / producerNum + 10));
+  for (size_t i = 0; i < recordNum; i++) {
+    size_t producer = i % producerNum;
+    const Name& producerPrefix = producerPrefixes[producer];
+    Record record(RecordType::GENERIC_RECORD, std::to_string(i));
+    record.addPointer(latest[(producer + 1) % producerNum]);
+    record.addPointer(latest[(producer + 2) % producerNum]);
+    if (payloadSize == 0) {
+      record.addRecordItem(makeStringBlock(255, std::to_string(i)));
+    }
+    else {
+      record.addRecordItem(makeBinaryBlock(255, payload.data(), payload.size()));
+    }
+
+    RecordName dataName(producerPrefix, record.getType(), record.getUniqueIdentifier(),
+                        start + time::seconds(2 * (i / producerNum)));
+    auto bodySegments = record.makeBodySegments(dataName);
+    for (const auto& segment : bodySegments) {
+      keychain.sign(*segment, signingWithSha256());
+      onPacket(segment);
+    }
+    record.setBodySegments(bodySegments);
+    auto data = make_shared<Data>(dataName);
+    data->setContent(record.wireEncode());
+    data->setFreshnessPeriod(time::minutes(5));
+    keychain.sign(*data, security::signingByIdentity(producerPrefix));
+    onPacket(data);
+    latest[producer] = data->getFullName();
+  }
+  return latest;
+}
+
+} // namespace dledger
+
+#endif // DLEDGER_TEST_TEST_HELPERS_HPP
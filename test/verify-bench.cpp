@@ -0,0 +1,127 @@
+#include "default-cert-manager.h"
+#include "verification-pool.hpp"
+#include "record_name.hpp"
+#include "dledger/record.hpp"
+#include "test-helpers.hpp"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/security/verification-helpers.hpp>
+#include <boost/asio/io_service.hpp>
+
+using namespace dledger;
+
+// Record verification latency, one by one and in batches, and throughput by number of verification threads.
+// Each measurement uses a new certificate manager, which remembers the records it verified.
+// Usage: verify-bench [number of records]
+
+const std::string anchorName = "/dledger";
+const size_t producerNum = 4;
+
+// @return the number of records verified per second
+double
+runVerification(const std::vector<shared_ptr<const Data>>& records, size_t nThreads,
+                const DefaultCertificateManager& certificateManager)
+{
+    boost::asio::io_service ioService;
+    // the results are posted while the io_service is waiting
+    boost::asio::io_service::work work(ioService);
+    VerificationPool pool(ioService, nThreads, [&] (const std::vector<shared_ptr<const Data>>& batch) {
+        auto signatureValid = certificateManager.verifySignatures(batch);
+        std::vector<VerificationResult> results(batch.size());
+        for (size_t i = 0; i < batch.size(); i++) {
+            results[i].signatureValid = signatureValid[i];
+            results[i].endorsed = signatureValid[i] && certificateManager.endorseSignature(*batch[i]);
+        }
+        return results;
+    });
+
+    size_t verified = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& record : records) {
+        pool.verify(record, [&] (const VerificationResult& result) {
+            if (!result.endorsed) {
+                std::cerr << "Bad signature" << std::endl;
+            }
+            verified++;
+        });
+    }
+    while (verified < records.size()) {
+        ioService.run_one();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return records.size() / elapsed.count();
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t recordNum = argc > 1 ? std::stoul(argv[1]) : 5000;
+    security::KeyChain keychain("pib-memory:", "tpm-memory:");
+    auto anchorIdentity = keychain.createIdentity(anchorName, EcKeyParams());
+    auto anchorCert = make_shared<security::Certificate>(anchorIdentity.getDefaultKey().getDefaultCertificate());
+    std::list<security::Certificate> producerCerts;
+    for (size_t i = 0; i < producerNum; i++) {
+        producerCerts.push_back(issueCertificate(keychain, Name(anchorName + "/bench-" + std::to_string(i)),
+                                                 anchorName, "bench-anchor"));
+    }
+
+    std::vector<shared_ptr<const Data>> records;
+    for (size_t i = 0; i < recordNum; i++) {
+        Name producerPrefix(anchorName + "/bench-" + std::to_string(i % producerNum));
+        Record record(RecordType::GENERIC_RECORD, std::to_string(i));
+        record.addRecordItem(makeStringBlock(255, std::to_string(i)));
+        auto data = make_shared<Data>(RecordName(producerPrefix, record.getType(), record.getUniqueIdentifier(),
+                                                 time::system_clock::now()));
+        data->setContent(record.wireEncode());
+        keychain.sign(*data, security::signingByIdentity(producerPrefix));
+        records.push_back(data);
+    }
+
+    // latency of one verification: parsing the key from the certificate each time
+    // against the keys kept by the certificate manager
+    std::map<Name, security::Certificate> certByIdentity;
+    for (const auto& cert : producerCerts) {
+        certByIdentity.emplace(cert.getIdentity(), cert);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& record : records) {
+        security::verifySignature(*record, certByIdentity.at(RecordName(record->getName()).getProducerPrefix()));
+    }
+    std::chrono::duration<double, std::micro> certificateLatency = std::chrono::steady_clock::now() - start;
+    DefaultCertificateManager oneByOneManager(anchorName, anchorCert, producerCerts);
+    start = std::chrono::steady_clock::now();
+    for (const auto& record : records) {
+        oneByOneManager.verifySignature(*record);
+    }
+    std::chrono::duration<double, std::micro> cachedLatency = std::chrono::steady_clock::now() - start;
+    DefaultCertificateManager batchManager(anchorName, anchorCert, producerCerts);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < recordNum; i += VerificationPool::MAX_BATCH_SIZE) {
+        auto end = records.begin() + std::min(recordNum, i + VerificationPool::MAX_BATCH_SIZE);
+        batchManager.verifySignatures(std::vector<shared_ptr<const Data>>(records.begin() + i, end));
+    }
+    std::chrono::duration<double, std::micro> batchLatency = std::chrono::steady_clock::now() - start;
+    std::cout << "Verification latency in microseconds" << std::endl;
+    std::cout << "key parsed from certificate\t" << certificateLatency.count() / recordNum << std::endl;
+    std::cout << "cached key\t" << cachedLatency.count() / recordNum << std::endl;
+    std::cout << "cached key, batches of " << VerificationPool::MAX_BATCH_SIZE << "\t"
+              << batchLatency.count() / recordNum << std::endl;
+
+    // the io thread verifies the records itself with 0 threads
+    std::vector<size_t> threadNums = {0, 1};
+    for (size_t n = 2; n <= std::thread::hardware_concurrency(); n *= 2) {
+        threadNums.push_back(n);
+    }
+    std::cout << "Verification of " << recordNum << " records" << std::endl;
+    std::cout << "threads\trecords/s" << std::endl;
+    for (auto nThreads : threadNums) {
+        DefaultCertificateManager certificateManager(anchorName, anchorCert, producerCerts);
+        std::cout << nThreads << "\t" << static_cast<long>(runVerification(records, nThreads, certificateManager))
+                  << std::endl;
+    }
+    return 0;
+}